@@ -1,4 +1,32 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* mremap() */
+#endif
+#include <limits.h>
+#include <math.h>
+#include <stdarg.h>
 #include "ary.h"
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#define ARY_HAVE_MMAP
+#define ARY_HAVE_PTHREAD
+#endif
+
+#if defined(__GNUC__) && defined(__SSE2__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define ARY_HAVE_SSE2
+#endif
+
+#if defined(MAP_ANONYMOUS)
+#define ARY_MMAP_ANON MAP_ANONYMOUS
+#elif defined(MAP_ANON)
+#define ARY_MMAP_ANON MAP_ANON
+#endif
 
 /* taken from OpenBSD */
 #define MUL_NO_OVERFLOW	((size_t)1 << (sizeof(size_t) * 4))
@@ -26,6 +54,38 @@ void ary_cb_freecharptr(void *buf, void *userp)
 	ary_xfree(*(char **)buf);
 }
 
+/* how many pointers ahead ary_cb_free*ptrs() prefetch */
+#define ARY_FREE_PREFETCH 8
+
+/* free() looks at the chunk header in front of the pointer */
+#ifdef __GNUC__
+#define ARY_PREFETCH_CHUNK(ptr)                                     \
+	__builtin_prefetch((void *)((uintptr_t)(ptr) - sizeof(size_t)), 1)
+#else
+#define ARY_PREFETCH_CHUNK(ptr) (void)(ptr)
+#endif
+
+/* define a range destructor that frees pointers of type `type` */
+#define ARY_FREEPTRS_DEFINE(name, type)                                        \
+	void name(void *first, size_t n, void *userp)                          \
+	{                                                                      \
+		ary_xdealloc_t xfree = ary_xfree;                              \
+		type *ptrs = first;                                            \
+		size_t i;                                                      \
+                                                                               \
+		(void)userp;                                                   \
+		for (i = 0; i < n; i++) {                                      \
+			type ahead = (i + ARY_FREE_PREFETCH < n) ?             \
+			             ptrs[i + ARY_FREE_PREFETCH] : NULL;       \
+			if (ahead)                                             \
+				ARY_PREFETCH_CHUNK(ahead);                     \
+			xfree(ptrs[i]);                                        \
+		}                                                              \
+	}
+
+ARY_FREEPTRS_DEFINE(ary_cb_freevoidptrs, void *)
+ARY_FREEPTRS_DEFINE(ary_cb_freecharptrs, char *)
+
 int ary_cb_cmpint(const void *a, const void *b)
 {
 	int x = *(const int *)a, y = *(const int *)b;
@@ -78,6 +138,142 @@ int ary_cb_strcasecmp(const void *a, const void *b)
 	return strcasecmp(*(char **)a, *(char **)b);
 }
 
+/* 64-bit FNV-1a */
+#define ARY_FNV_OFFSET 0xcbf29ce484222325ULL
+#define ARY_FNV_PRIME 0x100000001b3ULL
+
+size_t ary_cb_hashbytes(const void *elem, size_t sz)
+{
+	const unsigned char *p = elem;
+	uint64_t h = 0;
+
+	if (sz <= sizeof(h)) {
+		memcpy(&h, elem, sz);
+		h ^= h >> 33;
+		h *= 0xff51afd7ed558ccdULL;
+		h ^= h >> 33;
+		return (size_t)h;
+	}
+	for (h = ARY_FNV_OFFSET; sz--; p++)
+		h = (h ^ *p) * ARY_FNV_PRIME;
+	return (size_t)h;
+}
+
+size_t ary_cb_hashstr(const void *elem, size_t sz)
+{
+	const unsigned char *p = *(unsigned char **)elem;
+	uint64_t h = ARY_FNV_OFFSET;
+
+	(void)sz;
+	for (; p && *p; p++)
+		h = (h ^ *p) * ARY_FNV_PRIME;
+	return (size_t)h;
+}
+
+#define ARY_LT(a, b) ((a) < (b))
+
+ARY_SORT_DEFINE(static, ary_introsort_int, int, ARY_LT)
+ARY_SORT_DEFINE(static, ary_introsort_long, long, ARY_LT)
+ARY_SORT_DEFINE(static, ary_introsort_vlong, long long, ARY_LT)
+ARY_SORT_DEFINE(static, ary_introsort_size_t, size_t, ARY_LT)
+ARY_SORT_DEFINE(static, ary_introsort_double, double, ARY_LT)
+
+/* arrays from this length on are radix sorted */
+#define ARY_RADIX_THRESHOLD 1024
+
+/* define an LSD radix sort for an integer type, `sign` flips the sign bit;
+ * returns 0 if the temporary buffer couldn't be allocated */
+#define ARY_RADIX_DEFINE(name, type, utype, sign)                              \
+	static int name(type *buf, size_t len)                                 \
+	{                                                                      \
+		size_t count[256], i, sum, tmpsum;                             \
+		unsigned shift;                                                \
+		type *src = buf, *dst, *swp;                                   \
+                                                                               \
+		dst = ary_xrealloc(NULL, len, sizeof(type));                   \
+		if (!dst)                                                      \
+			return 0;                                              \
+		for (shift = 0; shift < sizeof(type) * CHAR_BIT; shift += 8) { \
+			memset(count, 0, sizeof(count));                       \
+			for (i = 0; i < len; i++)                              \
+				count[(((utype)src[i] ^ (sign)) >> shift) &    \
+				      0xff]++;                                 \
+			/* skip digits that are the same for all elements */   \
+			if (count[(((utype)src[0] ^ (sign)) >> shift) &        \
+			          0xff] == len)                                \
+				continue;                                      \
+			for (i = 0, sum = 0; i < 256; i++) {                   \
+				tmpsum = sum + count[i];                       \
+				count[i] = sum;                                \
+				sum = tmpsum;                                  \
+			}                                                      \
+			for (i = 0; i < len; i++)                              \
+				dst[count[(((utype)src[i] ^ (sign)) >>         \
+				           shift) & 0xff]++] = src[i];         \
+			swp = src;                                             \
+			src = dst;                                             \
+			dst = swp;                                             \
+		}                                                              \
+		if (src != buf) {                                              \
+			memcpy(buf, src, len * sizeof(type));                  \
+			dst = src;                                             \
+		}                                                              \
+		ary_xfree(dst);                                                \
+		return 1;                                                      \
+	}
+
+#define ARY_SIGNBIT(utype) ((utype)1 << (sizeof(utype) * CHAR_BIT - 1))
+
+ARY_RADIX_DEFINE(ary_radix_int, int, unsigned, ARY_SIGNBIT(unsigned))
+ARY_RADIX_DEFINE(ary_radix_long, long, unsigned long,
+                 ARY_SIGNBIT(unsigned long))
+ARY_RADIX_DEFINE(ary_radix_vlong, long long, unsigned long long,
+                 ARY_SIGNBIT(unsigned long long))
+ARY_RADIX_DEFINE(ary_radix_size_t, size_t, size_t, 0)
+
+void ary_sortbuf_int(int *buf, size_t len)
+{
+	if (len < ARY_RADIX_THRESHOLD || !ary_radix_int(buf, len))
+		ary_introsort_int(buf, len);
+}
+
+void ary_sortbuf_long(long *buf, size_t len)
+{
+	if (len < ARY_RADIX_THRESHOLD || !ary_radix_long(buf, len))
+		ary_introsort_long(buf, len);
+}
+
+void ary_sortbuf_vlong(long long *buf, size_t len)
+{
+	if (len < ARY_RADIX_THRESHOLD || !ary_radix_vlong(buf, len))
+		ary_introsort_vlong(buf, len);
+}
+
+void ary_sortbuf_size_t(size_t *buf, size_t len)
+{
+	if (len < ARY_RADIX_THRESHOLD || !ary_radix_size_t(buf, len))
+		ary_introsort_size_t(buf, len);
+}
+
+void ary_sortbuf_double(double *buf, size_t len)
+{
+	ary_introsort_double(buf, len);
+}
+
+void ary_sortbuf_char(char *buf, size_t len)
+{
+	size_t count[UCHAR_MAX + 1] = {0}, i, j;
+	unsigned flip = (CHAR_MIN < 0) ? (UCHAR_MAX + 1) / 2 : 0;
+
+	/* counting sort, chars are their own keys */
+	for (i = 0; i < len; i++)
+		count[(unsigned char)buf[i] ^ flip]++;
+	for (i = 0; i <= UCHAR_MAX; i++) {
+		for (j = count[i]; j--;)
+			*buf++ = (char)(unsigned char)(i ^ flip);
+	}
+}
+
 static const size_t snprintf_bufsize = 32;
 
 int ary_cb_voidptrtostr(char **ret, const void *elem)
@@ -129,6 +325,111 @@ int ary_cb_chartostr(char **ret, const void *elem)
 	return snprintf(*ret, snprintf_bufsize, "%d", *(char *)elem);
 }
 
+/* append `n` bytes of `str` to `out` */
+static int ary_appendmem(struct ary_char *out, const char *str, size_t n)
+{
+	if (!ary_grow(out, n))
+		return 0;
+	memcpy(out->buf + out->len, str, n);
+	out->len = out->s.len += n;
+	return 1;
+}
+
+static const char ary_digitpairs[] =
+	"00010203040506070809101112131415161718192021222324252627282930313233"
+	"34353637383940414243444546474849505152535455565758596061626364656667"
+	"6869707172737475767778798081828384858687888990919293949596979899";
+
+/* write `val` in decimal backwards from `end`, returns the first digit */
+static char *ary_utoa(char *end, unsigned long long val)
+{
+	while (val >= 100) {
+		end -= 2;
+		memcpy(end, ary_digitpairs + (val % 100) * 2, 2);
+		val /= 100;
+	}
+	if (val >= 10) {
+		end -= 2;
+		memcpy(end, ary_digitpairs + val * 2, 2);
+	} else {
+		*--end = (char)('0' + val);
+	}
+	return end;
+}
+
+static int ary_appendvlong(struct ary_char *out, long long val)
+{
+	char buf[24], *end = buf + sizeof(buf), *str;
+
+	/* negate in unsigned arithmetic, so that LLONG_MIN works */
+	str = ary_utoa(end, val < 0 ? -(unsigned long long)val :
+	                              (unsigned long long)val);
+	if (val < 0)
+		*--str = '-';
+	return ary_appendmem(out, str, end - str);
+}
+
+/* append a printf()-formatted string of at most 63 bytes */
+static int ary_appendf(struct ary_char *out, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	if (!ary_grow(out, 64))
+		return 0;
+	va_start(ap, fmt);
+	len = vsnprintf(out->buf + out->len, 64, fmt, ap);
+	va_end(ap);
+	if (len < 0 || len >= 64)
+		return 0;
+	out->len = out->s.len += len;
+	return 1;
+}
+
+int ary_cb_appendvoidptr(struct ary_char *out, const void *elem)
+{
+	return ary_appendf(out, "%p", *(void **)elem);
+}
+
+int ary_cb_appendint(struct ary_char *out, const void *elem)
+{
+	return ary_appendvlong(out, *(const int *)elem);
+}
+
+int ary_cb_appendlong(struct ary_char *out, const void *elem)
+{
+	return ary_appendvlong(out, *(const long *)elem);
+}
+
+int ary_cb_appendvlong(struct ary_char *out, const void *elem)
+{
+	return ary_appendvlong(out, *(const long long *)elem);
+}
+
+int ary_cb_appendsize_t(struct ary_char *out, const void *elem)
+{
+	char buf[24], *end = buf + sizeof(buf), *str;
+
+	str = ary_utoa(end, *(const size_t *)elem);
+	return ary_appendmem(out, str, end - str);
+}
+
+int ary_cb_appenddouble(struct ary_char *out, const void *elem)
+{
+	double val = *(const double *)elem;
+
+	/* integral values that "%g" prints without an exponent */
+	if (val > -1e6 && val < 1e6 && val == (double)(long long)val &&
+	    (val != 0 || !signbit(val)))
+		return ary_appendvlong(out, (long long)val);
+	return ary_appendf(out, "%g", val);
+}
+
+int ary_cb_appendchar(struct ary_char *out, const void *elem)
+{
+	return ary_appendvlong(out, *(const char *)elem);
+}
+
 void ary_use_as_realloc(ary_xalloc_t routine)
 {
 	ary_xrealloc = routine;
@@ -139,266 +440,2970 @@ void ary_use_as_free(ary_xdealloc_t routine)
 	ary_xfree = routine;
 }
 
-void ary_freebuf(struct aryb *ary)
+/* alignment of all arena allocations */
+#define ARY_ARENA_ALIGN 16
+#define ARY_ARENA_ROUND(n) \
+	(((n) + ARY_ARENA_ALIGN - 1) & ~(size_t)(ARY_ARENA_ALIGN - 1))
+
+struct ary_arenablk {
+	struct ary_arenablk *next;
+	size_t size;
+	size_t used;
+	/* followed by the allocations, each preceded by its size */
+};
+
+static const size_t ary_arenahdr =
+	ARY_ARENA_ROUND(sizeof(struct ary_arenablk));
+static const size_t ary_arenaelemhdr = ARY_ARENA_ROUND(sizeof(size_t));
+
+static void *ary_arena_realloc(void *ptr, size_t nmemb, size_t size,
+                               void *ctx)
 {
-	if (ary->len && ary->dtor) {
-		ary_elemcb_t dtor = ary->dtor;
-		char *elem = ary->buf;
-		void *userp = ary->userp;
-		size_t i;
+	struct ary_arena *arena = ctx;
+	struct ary_arenablk *blk = arena->blk;
+	size_t need, oldsz;
+	char *mem;
+
+	if ((nmemb >= MUL_NO_OVERFLOW || size >= MUL_NO_OVERFLOW) &&
+	    nmemb > 0 && SIZE_MAX / nmemb < size)
+		return NULL;
+	if (nmemb * size > SIZE_MAX - ary_arenahdr - 2 * ARY_ARENA_ALIGN)
+		return NULL;
+	need = ARY_ARENA_ROUND(nmemb * size);
+	if (ptr && ptr == arena->last) {
+		/* extend (or shrink) the most recent allocation in place */
+		mem = ptr;
+		if ((size_t)(mem - (char *)blk) + need <= blk->size) {
+			blk->used = (size_t)(mem - (char *)blk) + need;
+			*(size_t *)(mem - ary_arenaelemhdr) = need;
+			return ptr;
+		}
+	}
+	if (!blk || blk->size - blk->used < ary_arenaelemhdr + need) {
+		size_t blksz = ary_arenahdr + ary_arenaelemhdr + need;
 
-		for (i = ary->len; i--; elem += ary->sz)
-			dtor(elem, userp);
+		if (blksz < arena->blksz)
+			blksz = arena->blksz;
+		blk = ary_xrealloc(NULL, 1, blksz);
+		if (!blk)
+			return NULL;
+		blk->size = blksz;
+		blk->used = ary_arenahdr;
+		blk->next = arena->blk;
+		arena->blk = blk;
+	}
+	mem = (char *)blk + blk->used + ary_arenaelemhdr;
+	*(size_t *)(mem - ary_arenaelemhdr) = need;
+	blk->used += ary_arenaelemhdr + need;
+	if (ptr) {
+		oldsz = *(size_t *)((char *)ptr - ary_arenaelemhdr);
+		memcpy(mem, ptr, (oldsz < need) ? oldsz : need);
 	}
-	ary_xfree(ary->buf);
+	arena->last = mem;
+	return mem;
 }
 
-void *(ary_detach)(struct aryb *ary, size_t *ret)
+static void ary_arena_free(void *ptr, void *ctx)
 {
-	void *buf;
+	struct ary_arena *arena = ctx;
 
-	(ary_shrinktofit)(ary);
-	buf = ary->buf;
-	if (ret)
-		*ret = ary->len;
-	ary->alloc = ary->len = 0;
-	ary->buf = NULL;
-	return buf;
+	if (ptr && ptr == arena->last) {
+		arena->blk->used = (size_t)((char *)ptr - (char *)arena->blk) -
+		                   ary_arenaelemhdr;
+		arena->last = NULL;
+	}
 }
 
-int (ary_shrinktofit)(struct aryb *ary)
+void ary_arena_init(struct ary_arena *arena, size_t blksz)
 {
-	void *buf;
+	arena->allocator.realloc = ary_arena_realloc;
+	arena->allocator.free = ary_arena_free;
+	arena->allocator.ctx = arena;
+	arena->allocator.trim = NULL;
+	arena->blk = NULL;
+	arena->blksz = blksz ? blksz : 64 * 1024;
+	arena->last = NULL;
+}
 
-	if (ary->alloc == ary->len)
-		return 1;
-	if (ary->len) {
-		buf = ary_xrealloc(ary->buf, ary->len, ary->sz);
-		if (!buf)
-			return 0;
-	} else {
-		ary_xfree(ary->buf);
-		buf = NULL;
+void ary_arena_reset(struct ary_arena *arena)
+{
+	struct ary_arenablk *blk, *next;
+
+	if (!arena->blk)
+		return;
+	/* keep the oldest block for reuse */
+	for (blk = arena->blk; blk->next; blk = next) {
+		next = blk->next;
+		ary_xfree(blk);
 	}
-	ary->alloc = ary->len;
-	ary->buf = buf;
-	return 1;
+	blk->used = ary_arenahdr;
+	arena->blk = blk;
+	arena->last = NULL;
 }
 
-void *(ary_splicep)(struct aryb *ary, size_t pos, size_t rlen, size_t alen)
+void ary_arena_release(struct ary_arena *arena)
 {
-	char *buf;
+	ary_arena_reset(arena);
+	ary_xfree(arena->blk);
+	arena->blk = NULL;
+}
 
-	if (pos > ary->len)
-		pos = ary->len;
-	if (rlen > ary->len - pos)
-		rlen = ary->len - pos;
-	if (alen > rlen && !(ary_grow)(ary, alen - rlen))
-		return NULL;
-	buf = (char *)ary->buf + (pos * ary->sz);
-	if (rlen && ary->dtor) {
-		ary_elemcb_t dtor = ary->dtor;
-		char *elem = buf;
-		void *userp = ary->userp;
-		size_t i;
+/* precedes every allocation of an ary_mmap allocator */
+struct ary_mmaphdr {
+	size_t size;   /* requested size */
+	size_t mapped; /* size of the mapping, 0 if not mapped */
+};
 
-		for (i = rlen; i--; elem += ary->sz)
-			dtor(elem, userp);
-	}
-	if (rlen != alen && pos < ary->len)
-		memmove(buf + (alen * ary->sz), buf + (rlen * ary->sz),
-		        (ary->len - pos - rlen) * ary->sz);
-	ary->len = ary->len - rlen + alen;
-	return buf;
-}
+static const size_t ary_mmaphdrsz = ARY_ARENA_ROUND(sizeof(struct ary_mmaphdr));
 
-int (ary_index)(struct aryb *ary, size_t *ret, size_t start, const void *data,
-                ary_cmpcb_t comp)
+#ifdef ARY_MMAP_ANON
+static size_t ary_pagesize(void)
 {
-	size_t i;
-	char *elem = (char *)ary->buf + (start * ary->sz);
+	static size_t pagesize;
 
-	for (i = start; i < ary->len; i++, elem += ary->sz) {
-		if (comp ? !comp(elem, data) : !memcmp(elem, data, ary->sz)) {
-			if (ret)
-				*ret = i;
-			return 1;
-		}
+	if (!pagesize) {
+		long ret = sysconf(_SC_PAGESIZE);
+
+		pagesize = (ret > 0) ? (size_t)ret : 4096;
 	}
-	return 0;
+	return pagesize;
 }
 
-int (ary_rindex)(struct aryb *ary, size_t *ret, size_t start, const void *data,
-                 ary_cmpcb_t comp)
+/* move an allocation into a mapping of `mapped` bytes, or resize its mapping */
+static struct ary_mmaphdr *ary_mmap_remap(struct ary_mmap *mm,
+                                          struct ary_mmaphdr *hdr,
+                                          size_t mapped)
 {
-	size_t i;
-	char *elem;
+	void *mem;
 
-	if (start >= ary->len)
-		start = ary->len - 1;
-	elem = (char *)ary->buf + (start * ary->sz);
-	for (i = start; i--; elem -= ary->sz) {
-		if (comp ? !comp(elem, data) : !memcmp(elem, data, ary->sz)) {
-			if (ret)
-				*ret = i + 1;
-			return 1;
+	if (hdr && hdr->mapped == mapped)
+		return hdr;
+#ifdef MREMAP_MAYMOVE
+	if (hdr && hdr->mapped) {
+		mem = mremap(hdr, hdr->mapped, mapped, MREMAP_MAYMOVE);
+		if (mem == MAP_FAILED)
+			return NULL;
+	} else
+#endif
+	{
+		mem = mmap(NULL, mapped, PROT_READ | PROT_WRITE,
+		           MAP_PRIVATE | ARY_MMAP_ANON, -1, 0);
+		if (mem == MAP_FAILED)
+			return NULL;
+		if (hdr) {
+			size_t size = mapped - ary_mmaphdrsz;
+
+			memcpy((char *)mem + ary_mmaphdrsz,
+			       (char *)hdr + ary_mmaphdrsz,
+			       (hdr->size < size) ? hdr->size : size);
+			if (hdr->mapped)
+				munmap(hdr, hdr->mapped);
+			else
+				ary_xfree(hdr);
 		}
 	}
-	return 0;
+#ifdef MADV_HUGEPAGE
+	if (mm->flags & ARY_MMAP_HUGEPAGES)
+		madvise(mem, mapped, MADV_HUGEPAGE);
+#else
+	(void)mm;
+#endif
+	hdr = mem;
+	hdr->mapped = mapped;
+	return hdr;
 }
 
-int (ary_reverse)(struct aryb *ary)
+/* move a mapped allocation back to ary_xrealloc() */
+static struct ary_mmaphdr *ary_mmap_unmap(struct ary_mmaphdr *hdr,
+                                          size_t bytes)
 {
-	size_t i, j;
-	char *p, *q, *tmp;
+	struct ary_mmaphdr *mem;
 
-	tmp = ary_xrealloc(NULL, 1, ary->sz);
-	if (!tmp)
-		return 0;
-	j = ary->len - 1;
-	p = (char *)ary->buf;
-	q = p + (j * ary->sz);
-	for (i = 0; i < ary->len / 2; i++, j--) {
-		memcpy(tmp, p, ary->sz);
-		memcpy(p, q, ary->sz);
-		memcpy(q, tmp, ary->sz);
-		p += ary->sz;
-		q -= ary->sz;
-	}
-	ary_xfree(tmp);
-	return 1;
+	mem = ary_xrealloc(NULL, ary_mmaphdrsz + bytes, 1);
+	if (!mem)
+		return NULL;
+	memcpy((char *)mem + ary_mmaphdrsz, (char *)hdr + ary_mmaphdrsz,
+	       (hdr->size < bytes) ? hdr->size : bytes);
+	munmap(hdr, hdr->mapped);
+	mem->mapped = 0;
+	return mem;
 }
+#endif
 
-int (ary_join)(struct aryb *ary, char **ret, const char *sep,
-               ary_joincb_t stringify)
+static void *ary_mmap_realloc(void *ptr, size_t nmemb, size_t size, void *ctx)
 {
-	struct ary_char strbuf;
-	char *elem = (char *)ary->buf, *tmp;
-	size_t seplen = sep ? strlen(sep) : 0, i, len;
-	int tmplen, tmpret;
+	struct ary_mmap *mm = ctx;
+	struct ary_mmaphdr *hdr = NULL, *mem;
+	size_t bytes;
 
-	if (!ary_init(&strbuf, 1024))
-		goto error;
-	for (i = 0; i < ary->len; i++, elem += ary->sz) {
-		if (stringify) {
-			tmplen = stringify(&tmp, elem);
-			if (tmplen > 0) {
-				tmpret = ary_splice(&strbuf, strbuf.len, 0,
-				                    tmp, tmplen);
-				ary_xfree(tmp);
-				if (!tmpret)
-					goto error;
-			} else if (!tmplen) {
-				ary_xfree(tmp);
-			}
-		} else {
-			tmp = *(char **)elem;
-			if (!tmp)
-				continue;
-			if (!ary_splice(&strbuf, strbuf.len, 0, tmp,
-			                strlen(tmp)))
-				goto error;
-		}
-		if (seplen) {
-			if (!ary_splice(&strbuf, strbuf.len, 0, sep, seplen))
-				goto error;
-		}
-	}
-	if (!strbuf.len) {
-		if (!(*ret = strdup("")))
-			goto error;
-		return 0;
-	}
-	ary_setlen(&strbuf, strbuf.len - seplen + 1);
-	strbuf.buf[strbuf.len - 1] = '\0';
-	ary_shrinktofit(&strbuf);
-	*ret = ary_detach(&strbuf, &len);
-	return (int)len;
+	if ((nmemb >= MUL_NO_OVERFLOW || size >= MUL_NO_OVERFLOW) &&
+	    nmemb > 0 && SIZE_MAX / nmemb < size)
+		return NULL;
+	bytes = nmemb * size;
+	if (bytes > SIZE_MAX / 2)
+		return NULL;
+	if (ptr)
+		hdr = (struct ary_mmaphdr *)((char *)ptr - ary_mmaphdrsz);
+#ifdef ARY_MMAP_ANON
+	/* only give up a mapping if it has shrunk considerably */
+	if (bytes >= mm->threshold ||
+	    (hdr && hdr->mapped && bytes >= mm->threshold / 2)) {
+		size_t pagesize = ary_pagesize();
 
-error:
-	ary_release(&strbuf);
-	*ret = NULL;
-	return -1;
+		mem = ary_mmap_remap(mm, hdr, (ary_mmaphdrsz + bytes +
+		                               pagesize - 1) & ~(pagesize - 1));
+	} else if (hdr && hdr->mapped) {
+		mem = ary_mmap_unmap(hdr, bytes);
+	} else {
+		mem = ary_xrealloc(hdr, ary_mmaphdrsz + bytes, 1);
+		if (mem)
+			mem->mapped = 0;
+	}
+#else
+	(void)mm;
+	mem = ary_xrealloc(hdr, ary_mmaphdrsz + bytes, 1);
+	if (mem)
+		mem->mapped = 0;
+#endif
+	if (!mem)
+		return NULL;
+	mem->size = bytes;
+	return (char *)mem + ary_mmaphdrsz;
 }
 
-int (ary_swap)(struct aryb *ary, size_t a, size_t b)
+static void ary_mmap_free(void *ptr, void *ctx)
 {
-	char *p, *q, *tmp;
+	struct ary_mmaphdr *hdr;
 
-	if (a >= ary->len)
-		a = ary->len - 1;
-	if (b >= ary->len)
-		b = ary->len - 1;
-	if (a == b)
-		return 1;
-	tmp = ary_xrealloc(NULL, 1, ary->sz);
-	if (!tmp)
-		return 0;
-	p = (char *)ary->buf + (a * ary->sz);
-	q = (char *)ary->buf + (b * ary->sz);
-	memcpy(tmp, p, ary->sz);
-	memcpy(p, q, ary->sz);
-	memcpy(q, tmp, ary->sz);
-	ary_xfree(tmp);
-	return 1;
+	(void)ctx;
+	if (!ptr)
+		return;
+	hdr = (struct ary_mmaphdr *)((char *)ptr - ary_mmaphdrsz);
+#ifdef ARY_MMAP_ANON
+	if (hdr->mapped) {
+		munmap(hdr, hdr->mapped);
+		return;
+	}
+#endif
+	ary_xfree(hdr);
 }
 
-int (ary_search)(struct aryb *ary, size_t *ret, size_t start, const void *data,
-                 ary_cmpcb_t comp)
+static void ary_mmap_trim(void *ptr, size_t used, void *ctx)
 {
-	size_t count = (start < ary->len) ? ary->len - start : 0;
-	char *elem = (char *)ary->buf + (start * ary->sz);
-	void *ptr = bsearch(data, elem, count, ary->sz, comp);
+#if defined(ARY_MMAP_ANON) && defined(MADV_DONTNEED)
+	struct ary_mmaphdr *hdr;
+	size_t pagesize = ary_pagesize();
+	uintptr_t start, end;
 
+	(void)ctx;
 	if (!ptr)
-		return 0;
-	if (ret)
-		*ret = (size_t)((uintptr_t)ptr - (uintptr_t)ary->buf);
-	return 1;
+		return;
+	hdr = (struct ary_mmaphdr *)((char *)ptr - ary_mmaphdrsz);
+	if (!hdr->mapped)
+		return;
+	start = ((uintptr_t)ptr + used + pagesize - 1) & ~(pagesize - 1);
+	end = (uintptr_t)hdr + hdr->mapped;
+	if (start < end)
+		madvise((void *)start, end - start, MADV_DONTNEED);
+#else
+	(void)ptr;
+	(void)used;
+	(void)ctx;
+#endif
 }
 
-int (ary_unique)(struct aryb *ary, ary_cmpcb_t comp)
+void ary_mmap_init(struct ary_mmap *mm, size_t threshold, unsigned flags)
 {
-	void *list, *end;
-	size_t num, i;
-	char *elem;
+	mm->allocator.realloc = ary_mmap_realloc;
+	mm->allocator.free = ary_mmap_free;
+	mm->allocator.trim = ary_mmap_trim;
+	mm->allocator.ctx = mm;
+	mm->threshold = threshold ? threshold : 16 * 1024 * 1024;
+	mm->flags = flags;
+}
 
-	num = ary->len;
-	list = ary_xrealloc(NULL, num, ary->sz);
-	if (!list)
-		return 0;
-	end = (char *)list + num * ary->sz;
-	memcpy(list, ary->buf, num * ary->sz);
-	qsort(list, num, ary->sz, comp);
-	for (i = 0, elem = list; i < num - 1;) {
-		char *next = elem + ary->sz;
-
-		if (!comp(elem, next)) {
-			memmove(next, next + ary->sz, (num - i - 2) * ary->sz);
-			num--;
-		} else {
-			elem = next;
-			i++;
-		}
+/* header of files mapped by ary_map(), in native byte order */
+struct ary_filehdr {
+	char magic[8];
+	uint64_t sz;
+	uint64_t len;
+};
+
+static const char ary_filemagic[8] = "ary.c\0\0\1";
+
+/* offset of the elements in files mapped by ary_map() */
+#define ARY_FILEHDRSZ ((size_t)64)
+
+/* allocator of an array mapped by ary_map() */
+struct ary_filemap {
+	struct ary_allocator allocator;
+	struct aryb *ary;
+	int fd;
+	size_t mapped;
+};
+
+#ifdef ARY_HAVE_MMAP
+/* write an array's length into the header of its file */
+static void ary_filemap_store(struct ary_filemap *fm)
+{
+	struct aryb *ary = fm->ary;
+	struct ary_filehdr *hdr;
+
+	if (ary->head) {
+		char *base = (char *)ary->buf - (ary->head * ary->sz);
+
+		memmove(base, ary->buf, ary->len * ary->sz);
+		ary->alloc += ary->head;
+		ary->head = 0;
+		ary->buf = base;
 	}
-	for (i = 0, elem = ary->buf; i < ary->len;) {
-		void *ptr = bsearch(elem, list, num, ary->sz, comp);
-		size_t rest;
+	hdr = (struct ary_filehdr *)((char *)ary->buf - ARY_FILEHDRSZ);
+	hdr->len = ary->len;
+}
 
-		if (!ptr) {
-			if (ary->dtor)
-				ary->dtor(elem, ary->userp);
-			ptr = elem;
-			rest = (--ary->len - i) * ary->sz;
-		} else {
-			elem += ary->sz;
-			num--;
-			i++;
-			rest = (size_t)((uintptr_t)end - (uintptr_t)ptr) -
-			       ary->sz;
+static void *ary_filemap_realloc(void *ptr, size_t nmemb, size_t size,
+                                 void *ctx)
+{
+	struct ary_filemap *fm = ctx;
+	char *map;
+	size_t mapped;
+
+	if (!ptr)
+		return NULL;
+	if ((nmemb >= MUL_NO_OVERFLOW || size >= MUL_NO_OVERFLOW) &&
+	    nmemb > 0 && SIZE_MAX / nmemb < size)
+		return NULL;
+	if (nmemb * size > SIZE_MAX - ARY_FILEHDRSZ)
+		return NULL;
+	map = (char *)ptr - ARY_FILEHDRSZ;
+	mapped = ARY_FILEHDRSZ + nmemb * size;
+	if (mapped > fm->mapped && ftruncate(fm->fd, (off_t)mapped))
+		return NULL;
+#ifdef MREMAP_MAYMOVE
+	map = mremap(map, fm->mapped, mapped, MREMAP_MAYMOVE);
+	if (map == MAP_FAILED)
+		return NULL;
+#else
+	/* both mappings share the pages of the file, so nothing is copied */
+	ptr = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_SHARED, fm->fd, 0);
+	if (ptr == MAP_FAILED)
+		return NULL;
+	munmap(map, fm->mapped);
+	map = ptr;
+#endif
+	if (mapped < fm->mapped)
+		(void)ftruncate(fm->fd, (off_t)mapped);
+	fm->mapped = mapped;
+	return map + ARY_FILEHDRSZ;
+}
+
+static void ary_filemap_free(void *ptr, void *ctx)
+{
+	struct ary_filemap *fm = ctx;
+
+	(void)ptr;
+	ary_filemap_store(fm);
+	munmap((char *)fm->ary->buf - ARY_FILEHDRSZ, fm->mapped);
+	(void)ftruncate(fm->fd, (off_t)(ARY_FILEHDRSZ +
+	                                fm->ary->len * fm->ary->sz));
+	close(fm->fd);
+	fm->ary->allocator = NULL;
+	ary_xfree(fm);
+}
+
+int (ary_map)(struct aryb *ary, const char *path, unsigned flags)
+{
+	struct ary_filemap *fm;
+	struct ary_filehdr *hdr;
+	struct stat st;
+	char *map;
+	int oflags = O_RDWR;
+
+	if (flags & ARY_MAP_CREATE)
+		oflags |= O_CREAT;
+	if (flags & ARY_MAP_TRUNC)
+		oflags |= O_TRUNC;
+	fm = ary_xrealloc(NULL, 1, sizeof(*fm));
+	if (!fm)
+		return 0;
+	fm->fd = open(path, oflags, 0666);
+	if (fm->fd == -1)
+		goto error;
+	if (fstat(fm->fd, &st))
+		goto error;
+	if (!st.st_size) {
+		if (ftruncate(fm->fd, (off_t)ARY_FILEHDRSZ))
+			goto error;
+		st.st_size = ARY_FILEHDRSZ;
+	} else if ((uintmax_t)st.st_size < ARY_FILEHDRSZ ||
+	           (uintmax_t)st.st_size > SIZE_MAX) {
+		goto error;
+	}
+	fm->mapped = (size_t)st.st_size;
+	map = mmap(NULL, fm->mapped, PROT_READ | PROT_WRITE, MAP_SHARED,
+	           fm->fd, 0);
+	if (map == MAP_FAILED)
+		goto error;
+	hdr = (struct ary_filehdr *)map;
+	if (fm->mapped == ARY_FILEHDRSZ && !hdr->sz) {
+		memcpy(hdr->magic, ary_filemagic, sizeof(hdr->magic));
+		hdr->sz = ary->sz;
+		hdr->len = 0;
+	} else if (memcmp(hdr->magic, ary_filemagic, sizeof(hdr->magic)) ||
+	           hdr->sz != ary->sz ||
+	           hdr->len > (fm->mapped - ARY_FILEHDRSZ) / ary->sz) {
+		munmap(map, fm->mapped);
+		goto error;
+	}
+	fm->allocator.realloc = ary_filemap_realloc;
+	fm->allocator.free = ary_filemap_free;
+	fm->allocator.trim = NULL;
+	fm->allocator.ctx = fm;
+	fm->ary = ary;
+	ary->allocator = &fm->allocator;
+	ary->buf = map + ARY_FILEHDRSZ;
+	ary->len = hdr->len;
+	ary->alloc = (fm->mapped - ARY_FILEHDRSZ) / ary->sz;
+	return 1;
+
+error:
+	if (fm->fd != -1)
+		close(fm->fd);
+	ary_xfree(fm);
+	return 0;
+}
+
+/* check whether an array is mapped by ary_map() */
+static int ary_ismapped(const struct aryb *ary)
+{
+	return ary->allocator && ary->allocator->free == ary_filemap_free;
+}
+
+int (ary_sync)(struct aryb *ary)
+{
+	struct ary_filemap *fm;
+
+	if (!ary_ismapped(ary))
+		return 0;
+	fm = ary->allocator->ctx;
+	ary_filemap_store(fm);
+	return !msync((char *)ary->buf - ARY_FILEHDRSZ, fm->mapped, MS_SYNC);
+}
+#else
+static int ary_ismapped(const struct aryb *ary)
+{
+	(void)ary;
+	return 0;
+}
+
+int (ary_map)(struct aryb *ary, const char *path, unsigned flags)
+{
+	(void)ary;
+	(void)path;
+	(void)flags;
+	return 0;
+}
+
+int (ary_sync)(struct aryb *ary)
+{
+	(void)ary;
+	return 0;
+}
+#endif
+
+/* release memory with an array's allocator */
+static void ary_freemem(struct aryb *ary, void *ptr)
+{
+	if (ary->allocator)
+		ary->allocator->free(ptr, ary->allocator->ctx);
+	else
+		ary_xfree(ptr);
+}
+
+/* hash index of ary_sethashidx(), a multimap from hashes to positions with
+ * linear probing, the first `indexed` elements of the array are in it */
+struct ary_hidxent {
+	size_t pos; /* position + `off` at the time it was added */
+	size_t hash;
+};
+
+struct ary_hidx {
+	ary_hashcb_t hash;
+	ary_cmpcb_t comp;
+	struct ary_hidxent *tab;
+	size_t mask;    /* number of slots - 1 */
+	size_t used;    /* occupied slots, including those of removed elements */
+	size_t indexed;
+	size_t off;     /* number of elements shifted out since the last rebuild */
+};
+
+#define ARY_HIDX_EMPTY SIZE_MAX
+
+/* positions from `len` on are out of date, their slots are left as they are:
+ * lookups verify every candidate anyway and rebuilds drop them */
+void ary_hashidx_trunc(struct aryb *ary, size_t len)
+{
+	if (ary->hidx && ary->hidx->indexed > len)
+		ary->hidx->indexed = len;
+}
+
+static void ary_hidx_free(struct aryb *ary)
+{
+	if (!ary->hidx)
+		return;
+	ary_xfree(ary->hidx->tab);
+	ary_xfree(ary->hidx);
+	ary->hidx = NULL;
+}
+
+void ary_freebuf(struct aryb *ary)
+{
+	char *base = (char *)ary->buf - (ary->head * ary->sz);
+
+	ary_hidx_free(ary);
+	if (ary->len && (ary->dtor || ary->rdtor))
+		ary_destruct(ary, ary->buf, ary->len);
+	if (base != ary->inl) {
+		ARY_STATS_COUNT(ary, wasted,
+		                (ary->head + ary->alloc - ary->len) * ary->sz);
+		ary_freemem(ary, base);
+		ARY_TRACE_FREE(ary);
+	}
+}
+
+/* an array queued by ary_release_async() */
+struct ary_reclaim {
+	struct ary_reclaim *next;
+	struct aryb ary;
+	size_t done; /* number of elements destructed so far */
+};
+
+/* queue of ary_release_async() */
+static struct ary_reclaim *ary_reclaimhead;
+static struct ary_reclaim **ary_reclaimtail = &ary_reclaimhead;
+
+#ifdef ARY_HAVE_PTHREAD
+static pthread_mutex_t ary_reclaimlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ary_reclaimcond = PTHREAD_COND_INITIALIZER;
+static pthread_t ary_reclaimthread;
+static int ary_reclaimrunning, ary_reclaimstop;
+#endif
+
+#ifdef ARY_HAVE_PTHREAD
+#define ARY_RECLAIM_LOCK() pthread_mutex_lock(&ary_reclaimlock)
+#define ARY_RECLAIM_UNLOCK() pthread_mutex_unlock(&ary_reclaimlock)
+#else
+#define ARY_RECLAIM_LOCK() (void)0
+#define ARY_RECLAIM_UNLOCK() (void)0
+#endif
+
+void (ary_release_async)(struct aryb *ary)
+{
+	char *base = (char *)ary->buf - (ary->head * ary->sz);
+	struct ary_reclaim *node;
+
+	if (!ary->buf || base == ary->inl || ary_ismapped(ary) ||
+	    !(node = ary_xrealloc(NULL, 1, sizeof(*node)))) {
+		ary_freebuf(ary);
+		return;
+	}
+	ary_hidx_free(ary);
+	node->next = NULL;
+	node->ary = *ary;
+	node->done = 0;
+	ARY_RECLAIM_LOCK();
+	*ary_reclaimtail = node;
+	ary_reclaimtail = &node->next;
+#ifdef ARY_HAVE_PTHREAD
+	if (ary_reclaimrunning)
+		pthread_cond_signal(&ary_reclaimcond);
+#endif
+	ARY_RECLAIM_UNLOCK();
+}
+
+int ary_reclaim_step(size_t budget)
+{
+	struct ary_reclaim *node;
+	struct aryb *ary;
+	size_t n;
+	int pending;
+
+	if (!budget)
+		budget = SIZE_MAX;
+	ARY_RECLAIM_LOCK();
+	while (budget && (node = ary_reclaimhead)) {
+		/* take the node out, so that it's not processed twice */
+		if (!(ary_reclaimhead = node->next))
+			ary_reclaimtail = &ary_reclaimhead;
+		ARY_RECLAIM_UNLOCK();
+		ary = &node->ary;
+		n = ary->len - node->done;
+		if (ary->dtor || ary->rdtor) {
+			if (n > budget)
+				n = budget;
+			if (n)
+				ary_destruct(ary, (char *)ary->buf +
+				             (node->done * ary->sz), n);
+			budget -= n;
+		}
+		node->done += n;
+		if (node->done < ary->len) {
+			/* out of budget, continue with it next time */
+			ARY_RECLAIM_LOCK();
+			if (!(node->next = ary_reclaimhead))
+				ary_reclaimtail = &node->next;
+			ary_reclaimhead = node;
+			break;
+		}
+		ary->dtor = NULL;
+		ary->rdtor = NULL;
+		ary_freebuf(ary);
+		ary_xfree(node);
+		ARY_RECLAIM_LOCK();
+	}
+	pending = ary_reclaimhead != NULL;
+	ARY_RECLAIM_UNLOCK();
+	return pending;
+}
+
+#ifdef ARY_HAVE_PTHREAD
+static void *ary_reclaim_thread(void *arg)
+{
+	(void)arg;
+	ARY_RECLAIM_LOCK();
+	while (!ary_reclaimstop) {
+		if (!ary_reclaimhead) {
+			pthread_cond_wait(&ary_reclaimcond,
+			                  &ary_reclaimlock);
+			continue;
+		}
+		ARY_RECLAIM_UNLOCK();
+		ary_reclaim_step(0);
+		ARY_RECLAIM_LOCK();
+	}
+	ARY_RECLAIM_UNLOCK();
+	return NULL;
+}
+
+int ary_reclaim_start(void)
+{
+	int ret;
+
+	ARY_RECLAIM_LOCK();
+	if (!ary_reclaimrunning) {
+		ary_reclaimstop = 0;
+		ary_reclaimrunning = !pthread_create(&ary_reclaimthread,
+		                                       NULL, ary_reclaim_thread,
+		                                       NULL);
+	}
+	ret = ary_reclaimrunning;
+	ARY_RECLAIM_UNLOCK();
+	return ret;
+}
+
+void ary_reclaim_stop(void)
+{
+	ARY_RECLAIM_LOCK();
+	if (ary_reclaimrunning) {
+		ary_reclaimstop = 1;
+		pthread_cond_signal(&ary_reclaimcond);
+		ARY_RECLAIM_UNLOCK();
+		pthread_join(ary_reclaimthread, NULL);
+		ARY_RECLAIM_LOCK();
+		ary_reclaimrunning = 0;
+	}
+	ARY_RECLAIM_UNLOCK();
+	while (ary_reclaim_step(0))
+		;
+}
+#else
+int ary_reclaim_start(void)
+{
+	return 0;
+}
+
+void ary_reclaim_stop(void)
+{
+	while (ary_reclaim_step(0))
+		;
+}
+#endif
+
+/* atomics of the concurrent arrays, without compiler support every access is
+ * serialized by a single lock */
+#if defined(__GNUC__)
+#define ARY_FETCH_ADD(ptr, n) __atomic_fetch_add((ptr), (n), __ATOMIC_RELAXED)
+#define ARY_LOADLEN(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define ARY_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define ARY_STORE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#define ARY_CAS(ptr, old, val)                                            \
+	__atomic_compare_exchange_n((ptr), (old), (val), 0, __ATOMIC_ACQUIRE, \
+	                            __ATOMIC_RELAXED)
+#define ARY_YIELD() sched_yield()
+#else
+#ifdef ARY_HAVE_PTHREAD
+static pthread_mutex_t ary_conclock = PTHREAD_MUTEX_INITIALIZER;
+#define ARY_CONC_LOCK() pthread_mutex_lock(&ary_conclock)
+#define ARY_CONC_UNLOCK() pthread_mutex_unlock(&ary_conclock)
+#define ARY_YIELD() sched_yield()
+#else
+#define ARY_CONC_LOCK() (void)0
+#define ARY_CONC_UNLOCK() (void)0
+#define ARY_YIELD() (void)0
+#endif
+
+static size_t ary_fetch_add(size_t *ptr, size_t n)
+{
+	size_t old;
+
+	ARY_CONC_LOCK();
+	old = *ptr;
+	*ptr += n;
+	ARY_CONC_UNLOCK();
+	return old;
+}
+
+static void *ary_load(void **ptr)
+{
+	void *val;
+
+	ARY_CONC_LOCK();
+	val = *ptr;
+	ARY_CONC_UNLOCK();
+	return val;
+}
+
+static void ary_store(void **ptr, void *val)
+{
+	ARY_CONC_LOCK();
+	*ptr = val;
+	ARY_CONC_UNLOCK();
+}
+
+static int ary_cas(void **ptr, void **old, void *val)
+{
+	int ret;
+
+	ARY_CONC_LOCK();
+	if ((ret = *ptr == *old))
+		*ptr = val;
+	else
+		*old = *ptr;
+	ARY_CONC_UNLOCK();
+	return ret;
+}
+
+#define ARY_FETCH_ADD(ptr, n) ary_fetch_add((ptr), (n))
+#define ARY_LOADLEN(ptr) ary_fetch_add((ptr), 0)
+#define ARY_LOAD(ptr) ary_load((ptr))
+#define ARY_STORE(ptr, val) ary_store((ptr), (val))
+#define ARY_CAS(ptr, old, val) ary_cas((ptr), (old), (val))
+#endif
+
+#ifdef ARY_STATS
+/* counters of all arrays */
+static struct ary_stats ary_statstotal;
+
+static const struct {
+	const char *name;
+	size_t field;
+} ary_statsfields[] = {
+	{ "grows", offsetof(struct ary_stats, grows) },
+	{ "moved", offsetof(struct ary_stats, moved) },
+	{ "peak", offsetof(struct ary_stats, peak) },
+	{ "wasted", offsetof(struct ary_stats, wasted) },
+	{ "ctors", offsetof(struct ary_stats, ctors) },
+	{ "dtors", offsetof(struct ary_stats, dtors) }
+};
+
+#define ARY_STATSFIELD(stats, field) \
+	((size_t *)(void *)((char *)(stats) + (field)))
+#define ARY_NSTATSFIELDS (sizeof(ary_statsfields) / sizeof(ary_statsfields[0]))
+
+void ary_stats_count(struct aryb *ary, size_t field, size_t n)
+{
+	*ARY_STATSFIELD(&ary->stats, field) += n;
+	ARY_FETCH_ADD(ARY_STATSFIELD(&ary_statstotal, field), n);
+}
+
+/* raise `*ptr` to `val`, unless another thread raised it higher */
+static void ary_stats_max(size_t *ptr, size_t val)
+{
+#if defined(__GNUC__)
+	size_t old = __atomic_load_n(ptr, __ATOMIC_RELAXED);
+
+	while (old < val &&
+	       !__atomic_compare_exchange_n(ptr, &old, val, 1, __ATOMIC_RELAXED,
+	                                    __ATOMIC_RELAXED))
+		;
+#else
+	ARY_CONC_LOCK();
+	if (*ptr < val)
+		*ptr = val;
+	ARY_CONC_UNLOCK();
+#endif
+}
+
+void ary_stats_grown(struct aryb *ary)
+{
+	size_t cap = (ary->head + ary->alloc) * ary->sz;
+
+	ary_stats_count(ary, offsetof(struct ary_stats, grows), 1);
+	if (cap > ary->stats.peak) {
+		ary->stats.peak = cap;
+		ary_stats_max(&ary_statstotal.peak, cap);
+	}
+}
+
+void (ary_stats)(const struct aryb *ary, struct ary_stats *ret)
+{
+	const char *base = (const char *)ary->buf - (ary->head * ary->sz);
+
+	*ret = ary->stats;
+	ret->wasted = 0;
+	/* inline storage isn't allocated, even if shifted in deque-mode */
+	if (base != ary->inl)
+		ret->wasted = (ary->head + ary->alloc - ary->len) * ary->sz;
+}
+
+void ary_stats_total(struct ary_stats *ret)
+{
+	size_t i, field;
+
+	for (i = 0; i < ARY_NSTATSFIELDS; i++) {
+		field = ary_statsfields[i].field;
+		*ARY_STATSFIELD(ret, field) =
+			ARY_LOADLEN(ARY_STATSFIELD(&ary_statstotal, field));
+	}
+}
+
+void ary_stats_reset(void)
+{
+	size_t i, *ptr;
+
+	/* subtract what was read, so that concurrent counts remain */
+	for (i = 0; i < ARY_NSTATSFIELDS; i++) {
+		ptr = ARY_STATSFIELD(&ary_statstotal, ary_statsfields[i].field);
+		ARY_FETCH_ADD(ptr, -ARY_LOADLEN(ptr));
+	}
+}
+
+void ary_stats_export(const struct ary_stats *stats, ary_statscb_t cb,
+                      void *userp)
+{
+	size_t i;
+
+	for (i = 0; i < ARY_NSTATSFIELDS; i++)
+		cb(ary_statsfields[i].name,
+		   *(const size_t *)(const void *)((const char *)stats +
+		                                   ary_statsfields[i].field),
+		   userp);
+}
+
+static void ary_stats_print(const char *name, size_t val, void *userp)
+{
+	fprintf(userp, "%s %zu\n", name, val);
+}
+
+void ary_stats_dump(FILE *fp)
+{
+	struct ary_stats total;
+
+	ary_stats_total(&total);
+	ary_stats_export(&total, ary_stats_print, fp);
+}
+#endif
+
+#ifdef ARY_TRACE
+/* call sites of ary_init(), a hash table with linear probing */
+static struct ary_tracesite *ary_tracetab;
+static size_t ary_tracemask, ary_traceused;
+static size_t ary_tracerate = 1;
+static size_t ary_tracebytes; /* bytes allocated, modulo SIZE_MAX + 1 */
+
+#ifdef ARY_HAVE_PTHREAD
+static pthread_mutex_t ary_tracelock = PTHREAD_MUTEX_INITIALIZER;
+#define ARY_TRACE_LOCK() pthread_mutex_lock(&ary_tracelock)
+#define ARY_TRACE_UNLOCK() pthread_mutex_unlock(&ary_tracelock)
+#else
+#define ARY_TRACE_LOCK() (void)0
+#define ARY_TRACE_UNLOCK() (void)0
+#endif
+
+static size_t ary_trace_hash(const char *file, int line)
+{
+	const unsigned char *p = (const unsigned char *)file;
+	uint64_t h = ARY_FNV_OFFSET ^ (unsigned)line;
+
+	/* the same file can have several __FILE__ strings, one per object */
+	for (; *p; p++)
+		h = (h ^ *p) * ARY_FNV_PRIME;
+	return (size_t)h;
+}
+
+/* find or add the entry of a call site, must be called locked */
+static struct ary_tracesite *ary_trace_site(const char *file, int line)
+{
+	struct ary_tracesite *tab, *site;
+	size_t i, j, mask;
+
+	if (ary_tracetab) {
+		for (i = ary_trace_hash(file, line) & ary_tracemask;
+		     ary_tracetab[i].file; i = (i + 1) & ary_tracemask) {
+			site = &ary_tracetab[i];
+			if (site->line == line && (site->file == file ||
+			                           !strcmp(site->file, file)))
+				return site;
+		}
+	}
+	if ((ary_traceused + 1) * 2 > ary_tracemask) {
+		mask = ary_tracetab ? ary_tracemask * 2 + 1 : 63;
+		tab = ary_xrealloc(NULL, mask + 1, sizeof(*tab));
+		if (!tab)
+			return NULL;
+		memset(tab, 0, (mask + 1) * sizeof(*tab));
+		for (j = 0; ary_tracetab && j <= ary_tracemask; j++) {
+			if (!ary_tracetab[j].file)
+				continue;
+			for (i = ary_trace_hash(ary_tracetab[j].file,
+			                        ary_tracetab[j].line) & mask;
+			     tab[i].file; i = (i + 1) & mask)
+				;
+			tab[i] = ary_tracetab[j];
+		}
+		ary_xfree(ary_tracetab);
+		ary_tracetab = tab;
+		ary_tracemask = mask;
+	}
+	for (i = ary_trace_hash(file, line) & ary_tracemask;
+	     ary_tracetab[i].file; i = (i + 1) & ary_tracemask)
+		;
+	site = &ary_tracetab[i];
+	site->file = file;
+	site->line = line;
+	ary_traceused++;
+	return site;
+}
+
+void ary_trace_sample(size_t rate)
+{
+	/* ary_trace_resize() reads the rate without locking */
+	ARY_TRACE_LOCK();
+	ARY_FETCH_ADD(&ary_tracerate,
+	              (rate ? rate : 1) - ARY_LOADLEN(&ary_tracerate));
+	ARY_TRACE_UNLOCK();
+}
+
+void ary_trace_resize(struct aryb *ary, size_t bytes)
+{
+	struct ary_tracesite *site;
+	size_t grown, total, rate, samples, drop;
+
+	if (bytes <= ary->tracesz) {
+		/* give back the sampled bytes in proportion */
+		drop = ary->traced;
+		if (bytes)
+			drop -= (size_t)((double)ary->traced * bytes /
+			                 ary->tracesz);
+		ary->tracesz = bytes;
+		if (!drop)
+			return;
+		ary->traced -= drop;
+		ARY_TRACE_LOCK();
+		if ((site = ary_trace_site(ary->file, ary->line)))
+			site->live -= drop;
+		ARY_TRACE_UNLOCK();
+		return;
+	}
+	grown = bytes - ary->tracesz;
+	ary->tracesz = bytes;
+	/* take a sample whenever the total crosses a multiple of the rate */
+	rate = ARY_LOADLEN(&ary_tracerate);
+	total = ARY_FETCH_ADD(&ary_tracebytes, grown);
+	samples = (total + grown) / rate - total / rate;
+	if (total + grown < total)
+		samples = grown / rate + 1;
+	if (!samples)
+		return;
+	ARY_TRACE_LOCK();
+	if ((site = ary_trace_site(ary->file, ary->line))) {
+		site->live += samples * rate;
+		/* smaller reallocations are taken less often */
+		site->grows += (grown >= rate) ? 1 : rate / grown;
+		ary->traced += samples * rate;
+	}
+	ARY_TRACE_UNLOCK();
+}
+
+static int ary_trace_cmp(const void *a, const void *b)
+{
+	const struct ary_tracesite *x = a, *y = b;
+
+	if (x->live != y->live)
+		return (x->live < y->live) ? 1 : -1;
+	return (x->grows < y->grows) ? 1 : (x->grows > y->grows) ? -1 : 0;
+}
+
+size_t ary_trace_report(struct ary_tracesite *ret, size_t n)
+{
+	struct ary_tracesite *sites;
+	size_t i, nsites = 0;
+
+	ARY_TRACE_LOCK();
+	sites = ary_xrealloc(NULL, ary_traceused + 1, sizeof(*sites));
+	for (i = 0; sites && ary_tracetab && i <= ary_tracemask; i++)
+		if (ary_tracetab[i].file)
+			sites[nsites++] = ary_tracetab[i];
+	ARY_TRACE_UNLOCK();
+	if (!sites)
+		return 0;
+	qsort(sites, nsites, sizeof(*sites), ary_trace_cmp);
+	memcpy(ret, sites, ((n < nsites) ? n : nsites) * sizeof(*sites));
+	ary_xfree(sites);
+	return nsites;
+}
+
+void ary_trace_dump(FILE *fp, size_t n)
+{
+	struct ary_tracesite *sites;
+	size_t i, nsites;
+
+	if (!n || !(sites = ary_xrealloc(NULL, n, sizeof(*sites))))
+		return;
+	if ((nsites = ary_trace_report(sites, n)) < n)
+		n = nsites;
+	for (i = 0; i < n; i++)
+		fprintf(fp, "%s:%d %zu %zu\n", sites[i].file, sites[i].line,
+		        sites[i].live, sites[i].grows);
+	ary_xfree(sites);
+}
+#endif
+
+/* segments that are being allocated by another thread, or couldn't be */
+static char ary_concmark[2];
+#define ARY_CONC_BUSY ((void *)&ary_concmark[0])
+#define ARY_CONC_FAILED ((void *)&ary_concmark[1])
+
+/* index of the most significant bit set in `x` (> 0) */
+static inline unsigned ary_msb(size_t x)
+{
+#if defined(__GNUC__)
+	return (unsigned)(sizeof(unsigned long long) * 8 - 1) -
+	       (unsigned)__builtin_clzll(x);
+#else
+	unsigned ret = 0;
+
+	while (x >>= 1)
+		ret++;
+	return ret;
+#endif
+}
+
+/* get segment `k` of a concurrent array, allocate it if this thread is the
+ * first to need it; if `ahead` is set, it's only a preallocation that may fail
+ * without consequences, otherwise a failure sticks, as the slots reserved in
+ * the segment are lost */
+static void *ary_conc_getseg(struct aryc *c, size_t k, int ahead)
+{
+	void *seg, *old;
+
+	for (;;) {
+		seg = ARY_LOAD(&c->seg[k]);
+		if (seg == ARY_CONC_FAILED)
+			return NULL;
+		if (seg && seg != ARY_CONC_BUSY)
+			return seg;
+		if (seg) {
+			if (ahead)
+				return NULL;
+			ARY_YIELD();
+			continue;
+		}
+		old = NULL;
+		if (!ARY_CAS(&c->seg[k], &old, ARY_CONC_BUSY))
+			continue;
+		seg = ary_xrealloc(NULL, (size_t)1 << (ARY_CONC_SHIFT + k),
+		                   c->sz);
+		ARY_STORE(&c->seg[k], (seg || ahead) ? seg : ARY_CONC_FAILED);
+		return seg;
+	}
+}
+
+void (ary_conc_init)(struct aryc *c, size_t sz)
+{
+	size_t k;
+
+	c->len = 0;
+	c->sz = sz;
+	for (k = 0; k < ARY_CONC_SEGS; k++)
+		c->seg[k] = NULL;
+}
+
+void *(ary_conc_pushp)(struct aryc *c)
+{
+	size_t pos = ARY_FETCH_ADD(&c->len, 1) + ((size_t)1 << ARY_CONC_SHIFT);
+	unsigned bit = ary_msb(pos);
+	size_t k = bit - ARY_CONC_SHIFT, off = pos - ((size_t)1 << bit);
+	char *seg;
+
+	/* halfway through a segment, get the next one ready, so that the
+	 * other threads don't have to wait for it */
+	if (off == ((size_t)1 << (bit - 1)) && k + 1 < ARY_CONC_SEGS)
+		(void)ary_conc_getseg(c, k + 1, 1);
+	if (!(seg = ary_conc_getseg(c, k, 0)))
+		return NULL;
+	return seg + (off * c->sz);
+}
+
+int (ary_conc_push)(struct aryc *c, const void *data)
+{
+	void *ptr = (ary_conc_pushp)(c);
+
+	if (!ptr)
+		return 0;
+	memcpy(ptr, data, c->sz);
+	return 1;
+}
+
+void *(ary_conc_at)(struct aryc *c, size_t pos)
+{
+	unsigned bit;
+	char *seg;
+
+	if (pos >= ARY_LOADLEN(&c->len))
+		return NULL;
+	pos += (size_t)1 << ARY_CONC_SHIFT;
+	bit = ary_msb(pos);
+	seg = ARY_LOAD(&c->seg[bit - ARY_CONC_SHIFT]);
+	/* the slot is reserved, but its segment isn't allocated (yet) */
+	if (!seg || seg == ARY_CONC_BUSY || seg == ARY_CONC_FAILED)
+		return NULL;
+	return seg + ((pos - ((size_t)1 << bit)) * c->sz);
+}
+
+size_t (ary_conc_len)(struct aryc *c)
+{
+	return ARY_LOADLEN(&c->len);
+}
+
+void (ary_conc_release)(struct aryc *c)
+{
+	size_t k;
+
+	for (k = 0; k < ARY_CONC_SEGS; k++)
+		if (c->seg[k] != ARY_CONC_FAILED)
+			ary_xfree(c->seg[k]);
+	(ary_conc_init)(c, c->sz);
+}
+
+int (ary_conc_freeze)(struct aryc *c, struct aryb *ret)
+{
+	size_t k, n, left = c->len;
+	char *dst;
+
+	for (k = 0, n = 0; n < left; n += (size_t)1 << (ARY_CONC_SHIFT + k++))
+		if (c->seg[k] == ARY_CONC_FAILED)
+			return 0;
+	if (!(ary_grow)(ret, left))
+		return 0;
+	dst = ret->buf;
+	for (k = 0; left; k++, left -= n) {
+		n = (size_t)1 << (k + ARY_CONC_SHIFT);
+		if (n > left)
+			n = left;
+		memcpy(dst, c->seg[k], n * c->sz);
+		dst += n * c->sz;
+	}
+	ret->len = c->len;
+	(ary_conc_release)(c);
+	return 1;
+}
+
+/* make room for at least `extra` elements in front of the buffer */
+static int ary_growhead(struct aryb *ary, size_t extra)
+{
+	size_t head = (extra > ary->len) ? extra : ary->len;
+	char *buf;
+
+	if (head < 8)
+		head = 8;
+	buf = ary_allocbuf(ary, (char *)ary->buf - (ary->head * ary->sz),
+	                   head + ary->alloc);
+	if (!buf)
+		return 0;
+	memmove(buf + (head * ary->sz), buf + (ary->head * ary->sz),
+	        ary->len * ary->sz);
+	ARY_STATS_COUNT(ary, moved, ary->len * ary->sz);
+	ary->head = head;
+	ary->buf = buf + (head * ary->sz);
+	ARY_STATS_GROWN(ary);
+	ARY_TRACE_RESIZE(ary);
+	return 1;
+}
+
+void (ary_trim)(struct aryb *ary, size_t len)
+{
+	char *base = (char *)ary->buf - (ary->head * ary->sz);
+
+	/* shrinking by a few elements at a time would give back the same pages
+	 * over and over, so only trim if the length is at least halved */
+	if (len > ary->len / 2)
+		return;
+	if (ary->allocator && ary->allocator->trim && base != ary->inl)
+		ary->allocator->trim(base, (ary->head + len) * ary->sz,
+		                     ary->allocator->ctx);
+}
+
+void (ary_shift)(struct aryb *ary)
+{
+	if (ary->hidx) {
+		ary->hidx->off++;
+		if (ary->hidx->indexed)
+			ary->hidx->indexed--;
+	}
+	if (!(ary->flags & ARY_DEQUE)) {
+		memmove(ary->buf, (char *)ary->buf + ary->sz,
+		        --ary->len * ary->sz);
+		ARY_STATS_COUNT(ary, moved, ary->len * ary->sz);
+		return;
+	}
+	if (--ary->len) {
+		ary->buf = (char *)ary->buf + ary->sz;
+		ary->head++;
+		ary->alloc--;
+	} else {
+		ary->buf = (char *)ary->buf - (ary->head * ary->sz);
+		ary->alloc += ary->head;
+		ary->head = 0;
+	}
+}
+
+void *(ary_detach)(struct aryb *ary, size_t *ret)
+{
+	void *buf;
+
+	(ary_shrinktofit)(ary);
+	buf = ary->buf;
+	if (buf && buf == ary->inl) {
+		buf = NULL;
+		if (ary->len) {
+			buf = ary_allocbuf(ary, NULL, ary->len);
+			if (!buf)
+				return NULL;
+			memcpy(buf, ary->inl, ary->len * ary->sz);
+		}
+	}
+	if (ret)
+		*ret = ary->len;
+	ary_hashidx_trunc(ary, 0);
+	ary->len = 0;
+	ary->alloc = ary->ninl;
+	ary->buf = ary->inl;
+	ARY_TRACE_RESIZE(ary);
+	return buf;
+}
+
+int (ary_shrinktofit)(struct aryb *ary)
+{
+	void *buf;
+
+	if (ary->head) {
+		buf = (char *)ary->buf - (ary->head * ary->sz);
+		memmove(buf, ary->buf, ary->len * ary->sz);
+		ary->alloc += ary->head;
+		ary->head = 0;
+		ary->buf = buf;
+	}
+	if (ary->inl) {
+		if (ary->buf == ary->inl)
+			return 1;
+		if (ary->len <= ary->ninl) {
+			memcpy(ary->inl, ary->buf, ary->len * ary->sz);
+			ary_freemem(ary, ary->buf);
+			ary->alloc = ary->ninl;
+			ary->buf = ary->inl;
+			ARY_TRACE_RESIZE(ary);
+			return 1;
+		}
+	}
+	if (ary->alloc == ary->len)
+		return 1;
+	if (ary->len) {
+		buf = ary_allocbuf(ary, ary->buf, ary->len);
+		if (!buf)
+			return 0;
+	} else {
+		ary_freemem(ary, ary->buf);
+		buf = NULL;
+	}
+	ary->alloc = ary->len;
+	ary->buf = buf;
+	ARY_TRACE_RESIZE(ary);
+	return 1;
+}
+
+void *(ary_push_n_uninit)(struct aryb *ary, size_t n)
+{
+	void *ptr;
+
+	if (!n || n > SIZE_MAX - ary->len || !(ary_grow)(ary, n))
+		return NULL;
+	ptr = (char *)ary->buf + (ary->len * ary->sz);
+	ary->len += n;
+	return ptr;
+}
+
+int (ary_push_n)(struct aryb *ary, size_t n, const void *val)
+{
+	char *ptr;
+	size_t done, total = n * ary->sz;
+
+	if (!n)
+		return 1;
+	if (!(ptr = (ary_push_n_uninit)(ary, n)))
+		return 0;
+	if (ary->ctor || ary->rctor) {
+		ary_construct(ary, ptr, n);
+	} else {
+		/* fill by doubling the initialized part */
+		memcpy(ptr, val, ary->sz);
+		for (done = ary->sz; done < total; done *= 2)
+			memcpy(ptr + done, ptr,
+			       (total - done < done) ? total - done : done);
+	}
+	return 1;
+}
+
+int (ary_extend)(struct aryb *ary, const void *data, size_t n)
+{
+	uintptr_t src = (uintptr_t)data, buf = (uintptr_t)ary->buf;
+	int inside = src >= buf && src < buf + (ary->len * ary->sz);
+	void *ptr;
+
+	if (!n)
+		return 1;
+	/* growing moves the buffer, so remember where `data` is in it */
+	if (!(ptr = (ary_push_n_uninit)(ary, n)))
+		return 0;
+	if (inside)
+		data = (char *)ary->buf + (src - buf);
+	memcpy(ptr, data, n * ary->sz);
+	return 1;
+}
+
+void *(ary_splicep)(struct aryb *ary, size_t pos, size_t rlen, size_t alen)
+{
+	char *buf;
+	int front;
+
+	if (pos > ary->len)
+		pos = ary->len;
+	if (rlen > ary->len - pos)
+		rlen = ary->len - pos;
+	/* in deque-mode, move the smaller part of the array */
+	front = (ary->flags & ARY_DEQUE) && rlen != alen &&
+	        pos < ary->len - pos - rlen;
+	if (front) {
+		if (alen > rlen && ary->head < alen - rlen &&
+		    !ary_growhead(ary, alen - rlen))
+			return NULL;
+	} else if (alen > rlen && !(ary_grow)(ary, alen - rlen)) {
+		return NULL;
+	}
+	buf = (char *)ary->buf + (pos * ary->sz);
+	if (pos + rlen == ary->len)
+		ary_hashidx_trunc(ary, pos);
+	else if (rlen || alen)
+		ary->flags |= ARY_STALE;
+	if (rlen && (ary->dtor || ary->rdtor))
+		ary_destruct(ary, buf, rlen);
+	if (front) {
+		char *old = ary->buf;
+
+		if (alen > rlen) {
+			ary->head -= alen - rlen;
+			ary->alloc += alen - rlen;
+			ary->buf = old - ((alen - rlen) * ary->sz);
+		} else {
+			ary->head += rlen - alen;
+			ary->alloc -= rlen - alen;
+			ary->buf = old + ((rlen - alen) * ary->sz);
+		}
+		memmove(ary->buf, old, pos * ary->sz);
+		ARY_STATS_COUNT(ary, moved, pos * ary->sz);
+		buf = (char *)ary->buf + (pos * ary->sz);
+	} else if (rlen != alen && pos < ary->len) {
+		memmove(buf + (alen * ary->sz), buf + (rlen * ary->sz),
+		        (ary->len - pos - rlen) * ary->sz);
+		ARY_STATS_COUNT(ary, moved, (ary->len - pos - rlen) * ary->sz);
+	}
+	ary->len = ary->len - rlen + alen;
+	return buf;
+}
+
+/* compare two elements bytewise */
+static inline int ary_memeq(const void *a, const void *b, size_t sz)
+{
+	uint16_t x16, y16;
+	uint32_t x32, y32;
+	uint64_t x64, y64;
+
+	switch (sz) {
+	case 1:
+		return *(const char *)a == *(const char *)b;
+	case 2:
+		memcpy(&x16, a, 2);
+		memcpy(&y16, b, 2);
+		return x16 == y16;
+	case 4:
+		memcpy(&x32, a, 4);
+		memcpy(&y32, b, 4);
+		return x32 == y32;
+	case 8:
+		memcpy(&x64, a, 8);
+		memcpy(&y64, b, 8);
+		return x64 == y64;
+	}
+	return !memcmp(a, b, sz);
+}
+
+static size_t ary_memfind_scalar(const char *buf, size_t n, const void *data,
+                                 size_t sz)
+{
+	size_t i;
+
+	for (i = 0; i < n; i++, buf += sz) {
+		if (ary_memeq(buf, data, sz))
+			return i;
+	}
+	return n;
+}
+
+static size_t ary_memrfind_scalar(const char *buf, size_t n, const void *data,
+                                  size_t sz)
+{
+	size_t i;
+
+	for (i = n, buf += n * sz; i--;) {
+		buf -= sz;
+		if (ary_memeq(buf, data, sz))
+			return i;
+	}
+	return n;
+}
+
+static size_t ary_memcount_scalar(const char *buf, size_t n, const void *data,
+                                  size_t sz)
+{
+	size_t i, count = 0;
+
+	for (i = 0; i < n; i++, buf += sz)
+		count += ary_memeq(buf, data, sz);
+	return count;
+}
+
+#ifdef ARY_HAVE_SSE2
+/* reduce a mask of equal bytes to the lowest bit of each equal element */
+static inline uint32_t ary_lanemask(uint32_t m, size_t sz)
+{
+	switch (sz) {
+	case 2:
+		return m & (m >> 1) & 0x55555555;
+	case 4:
+		m &= m >> 1;
+		return m & (m >> 2) & 0x11111111;
+	case 8:
+		m &= m >> 1;
+		m &= m >> 2;
+		return m & (m >> 4) & 0x01010101;
+	case 16:
+		m &= m >> 1;
+		m &= m >> 2;
+		m &= m >> 4;
+		return m & (m >> 8) & 0x00010001;
+	}
+	return m;
+}
+
+/* define vectorized versions of ary_mem*_scalar() for elements of `sz` bytes,
+ * `pat` is the element repeated to fill a vector */
+#define ARY_SCAN_DEFINE(name, attr, sz, vtype, width, loadu, cmpeq, movemask)  \
+	attr static size_t name##find##sz(const char *buf, size_t n,           \
+	                                  const unsigned char *pat)            \
+	{                                                                      \
+		vtype key = loadu((const vtype *)pat);                         \
+		size_t i, end = n * (sz) / (width) * (width);                  \
+		uint32_t m;                                                    \
+                                                                               \
+		for (i = 0; i < end; i += (width)) {                           \
+			m = (uint32_t)movemask(cmpeq(                          \
+				loadu((const vtype *)(buf + i)), key));        \
+			if (m && (m = ary_lanemask(m, (sz))))                  \
+				return (i + __builtin_ctz(m)) / (sz);          \
+		}                                                              \
+		return end / (sz) + ary_memfind_scalar(buf + end,              \
+		                                       n - end / (sz), pat,    \
+		                                       (sz));                  \
+	}                                                                      \
+                                                                               \
+	attr static size_t name##rfind##sz(const char *buf, size_t n,          \
+	                                   const unsigned char *pat)           \
+	{                                                                      \
+		vtype key = loadu((const vtype *)pat);                         \
+		size_t i, end = n * (sz) / (width) * (width);                  \
+		uint32_t m;                                                    \
+                                                                               \
+		i = ary_memrfind_scalar(buf + end, n - end / (sz), pat, (sz)); \
+		if (i != n - end / (sz))                                       \
+			return end / (sz) + i;                                 \
+		for (i = end; i;) {                                            \
+			i -= (width);                                          \
+			m = (uint32_t)movemask(cmpeq(                          \
+				loadu((const vtype *)(buf + i)), key));        \
+			if (m && (m = ary_lanemask(m, (sz))))                  \
+				return (i + 31 - __builtin_clz(m)) / (sz);     \
+		}                                                              \
+		return n;                                                      \
+	}                                                                      \
+                                                                               \
+	attr static size_t name##count##sz(const char *buf, size_t n,          \
+	                                   const unsigned char *pat)           \
+	{                                                                      \
+		vtype key = loadu((const vtype *)pat);                         \
+		size_t i, end = n * (sz) / (width) * (width), count = 0;       \
+		uint32_t m;                                                    \
+                                                                               \
+		for (i = 0; i < end; i += (width)) {                           \
+			m = (uint32_t)movemask(cmpeq(                          \
+				loadu((const vtype *)(buf + i)), key));        \
+			count += __builtin_popcount(ary_lanemask(m, (sz)));    \
+		}                                                              \
+		return count + ary_memcount_scalar(buf + end, n - end / (sz),  \
+		                                   pat, (sz));                 \
+	}
+
+#define ARY_SSE2_DEFINE(sz, cmpeq)                                      \
+	ARY_SCAN_DEFINE(ary_sse2_, , sz, __m128i, 16, _mm_loadu_si128, \
+	                cmpeq, _mm_movemask_epi8)
+#define ARY_AVX2_DEFINE(sz, cmpeq)                                             \
+	ARY_SCAN_DEFINE(ary_avx2_, __attribute__((target("avx2"))), sz,       \
+	                __m256i, 32, _mm256_loadu_si256, cmpeq,                \
+	                _mm256_movemask_epi8)
+
+/* compare whole lanes where possible, ary_lanemask() combines the rest */
+ARY_SSE2_DEFINE(1, _mm_cmpeq_epi8)
+ARY_SSE2_DEFINE(2, _mm_cmpeq_epi16)
+ARY_SSE2_DEFINE(4, _mm_cmpeq_epi32)
+ARY_SSE2_DEFINE(8, _mm_cmpeq_epi32)
+ARY_SSE2_DEFINE(16, _mm_cmpeq_epi32)
+ARY_AVX2_DEFINE(1, _mm256_cmpeq_epi8)
+ARY_AVX2_DEFINE(2, _mm256_cmpeq_epi16)
+ARY_AVX2_DEFINE(4, _mm256_cmpeq_epi32)
+ARY_AVX2_DEFINE(8, _mm256_cmpeq_epi64)
+ARY_AVX2_DEFINE(16, _mm256_cmpeq_epi64)
+
+typedef size_t (*ary_scanfn_t)(const char *buf, size_t n,
+                               const unsigned char *pat);
+
+/* search modes of ary_memscan() */
+enum { ARY_FIND, ARY_RFIND, ARY_COUNT };
+
+#define ARY_SCAN_TABLE(name)                                                   \
+	{                                                                      \
+		{name##find1, name##find2, name##find4, name##find8,           \
+		 name##find16},                                                \
+		{name##rfind1, name##rfind2, name##rfind4, name##rfind8,       \
+		 name##rfind16},                                               \
+		{name##count1, name##count2, name##count4, name##count8,       \
+		 name##count16}                                                \
+	}
+
+static const ary_scanfn_t ary_sse2_scan[3][5] = ARY_SCAN_TABLE(ary_sse2_);
+static const ary_scanfn_t ary_avx2_scan[3][5] = ARY_SCAN_TABLE(ary_avx2_);
+
+/* dispatch to the widest vectorized search the cpu supports */
+static size_t ary_memscan(int mode, const char *buf, size_t n,
+                          const void *data, size_t sz)
+{
+	unsigned char pat[32];
+	size_t i;
+	int lg;
+
+	if (sz > 16 || (sz & (sz - 1))) {
+		if (mode == ARY_FIND)
+			return ary_memfind_scalar(buf, n, data, sz);
+		if (mode == ARY_RFIND)
+			return ary_memrfind_scalar(buf, n, data, sz);
+		return ary_memcount_scalar(buf, n, data, sz);
+	}
+	for (lg = 0; (size_t)1 << lg != sz; lg++)
+		;
+	for (i = 0; i < sizeof(pat); i += sz)
+		memcpy(pat + i, data, sz);
+	if (__builtin_cpu_supports("avx2"))
+		return ary_avx2_scan[mode][lg](buf, n, pat);
+	return ary_sse2_scan[mode][lg](buf, n, pat);
+}
+#endif
+
+/* get the position of the first element that equals `data` bytewise among the
+ * `n` elements at `buf`, or `n` if there is none */
+static size_t ary_memfind(const char *buf, size_t n, const void *data,
+                          size_t sz)
+{
+	if (sz == 1) {
+		const char *ptr = memchr(buf, *(const unsigned char *)data, n);
+
+		return ptr ? (size_t)(ptr - buf) : n;
+	}
+#ifdef ARY_HAVE_SSE2
+	return ary_memscan(ARY_FIND, buf, n, data, sz);
+#else
+	return ary_memfind_scalar(buf, n, data, sz);
+#endif
+}
+
+/* like ary_memfind(), but get the last position */
+static size_t ary_memrfind(const char *buf, size_t n, const void *data,
+                           size_t sz)
+{
+#ifdef ARY_HAVE_SSE2
+	return ary_memscan(ARY_RFIND, buf, n, data, sz);
+#else
+	return ary_memrfind_scalar(buf, n, data, sz);
+#endif
+}
+
+/* get the number of elements that equal `data` bytewise */
+static size_t ary_memcount(const char *buf, size_t n, const void *data,
+                           size_t sz)
+{
+#ifdef ARY_HAVE_SSE2
+	return ary_memscan(ARY_COUNT, buf, n, data, sz);
+#else
+	return ary_memcount_scalar(buf, n, data, sz);
+#endif
+}
+
+/* first slot to probe for `hash`, user hashes might be poorly mixed */
+static inline size_t ary_hidx_slot(const struct ary_hidx *h, size_t hash)
+{
+	uint64_t x = hash;
+
+	x ^= x >> 29;
+	x *= 0xbf58476d1ce4e5b9ULL;
+	x ^= x >> 32;
+	return (size_t)x & h->mask;
+}
+
+/* bring an array's hash index up to date, rebuild it if it's stale, has
+ * collected too many slots of removed elements or would get too full;
+ * returns 0 if the table couldn't be allocated */
+static int ary_hidx_sync(struct aryb *ary)
+{
+	struct ary_hidx *h = ary->hidx;
+	struct ary_hidxent *tab;
+	const char *elem;
+	size_t n, p, i, hash;
+
+	if ((ary->flags & ARY_STALE) || h->used - h->indexed > h->indexed ||
+	    (h->used + ary->len - h->indexed) * 2 > h->mask + 1) {
+		for (n = 16; n / 2 <= ary->len; n *= 2)
+			if (n > SIZE_MAX / 4 / sizeof(*tab))
+				return 0;
+		if (n - 1 != h->mask) {
+			tab = ary_xrealloc(NULL, n, sizeof(*tab));
+			if (!tab)
+				return 0;
+			ary_xfree(h->tab);
+			h->tab = tab;
+			h->mask = n - 1;
+		}
+		memset(h->tab, 0xff, n * sizeof(*h->tab));
+		h->used = h->indexed = h->off = 0;
+		ary->flags &= ~(unsigned)ARY_STALE;
+	}
+	elem = (char *)ary->buf + (h->indexed * ary->sz);
+	for (p = h->indexed; p < ary->len; p++, elem += ary->sz) {
+		hash = h->hash(elem, ary->sz);
+		for (i = ary_hidx_slot(h, hash); h->tab[i].pos != ARY_HIDX_EMPTY;
+		     i = (i + 1) & h->mask)
+			;
+		h->tab[i].pos = p + h->off;
+		h->tab[i].hash = hash;
+	}
+	h->used += ary->len - h->indexed;
+	h->indexed = ary->len;
+	return 1;
+}
+
+/* ary_index() via the hash index, every candidate is compared as slots of
+ * removed or replaced elements might still be around */
+static int ary_hidx_find(struct aryb *ary, size_t *ret, size_t start,
+                         const void *data, ary_cmpcb_t comp)
+{
+	struct ary_hidx *h = ary->hidx;
+	size_t hash = h->hash(data, ary->sz), found = ary->len, i, p;
+	const char *elem;
+
+	for (i = ary_hidx_slot(h, hash); h->tab[i].pos != ARY_HIDX_EMPTY;
+	     i = (i + 1) & h->mask) {
+		if (h->tab[i].hash != hash)
+			continue;
+		/* wraps around for elements that were shifted out */
+		p = h->tab[i].pos - h->off;
+		if (p < start || p >= found)
+			continue;
+		elem = (char *)ary->buf + (p * ary->sz);
+		if (comp ? !comp(elem, data) : ary_memeq(elem, data, ary->sz))
+			found = p;
+	}
+	if (found == ary->len)
+		return 0;
+	if (ret)
+		*ret = found;
+	return 1;
+}
+
+int (ary_sethashidx)(struct aryb *ary, ary_hashcb_t hash, ary_cmpcb_t comp)
+{
+	struct ary_hidx *h;
+
+	ary_hidx_free(ary);
+	if (!hash)
+		return 1;
+	h = ary_xrealloc(NULL, 1, sizeof(*h));
+	if (!h)
+		return 0;
+	h->hash = hash;
+	h->comp = comp;
+	h->tab = NULL;
+	h->mask = h->used = h->indexed = h->off = 0;
+	ary->hidx = h;
+	ary->flags |= ARY_STALE;
+	if (!ary_hidx_sync(ary)) {
+		ary_hidx_free(ary);
+		return 0;
+	}
+	return 1;
+}
+
+int (ary_index)(struct aryb *ary, size_t *ret, size_t start, const void *data,
+                ary_cmpcb_t comp)
+{
+	size_t i;
+	char *elem = (char *)ary->buf + (start * ary->sz);
+
+	if (start >= ary->len)
+		return 0;
+	if (ary->hidx && ary->hidx->comp == comp && ary_hidx_sync(ary))
+		return ary_hidx_find(ary, ret, start, data, comp);
+	if (!comp) {
+		i = start + ary_memfind(elem, ary->len - start, data, ary->sz);
+		if (i == ary->len)
+			return 0;
+		if (ret)
+			*ret = i;
+		return 1;
+	}
+	for (i = start; i < ary->len; i++, elem += ary->sz) {
+		if (!comp(elem, data)) {
+			if (ret)
+				*ret = i;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+int (ary_rindex)(struct aryb *ary, size_t *ret, size_t start, const void *data,
+                 ary_cmpcb_t comp)
+{
+	size_t i;
+	char *elem;
+
+	if (!ary->len)
+		return 0;
+	if (start >= ary->len)
+		start = ary->len - 1;
+	if (!comp) {
+		i = ary_memrfind(ary->buf, start + 1, data, ary->sz);
+		if (i == start + 1)
+			return 0;
+		if (ret)
+			*ret = i;
+		return 1;
+	}
+	elem = (char *)ary->buf + (start * ary->sz);
+	for (i = start + 1; i--; elem -= ary->sz) {
+		if (!comp(elem, data)) {
+			if (ret)
+				*ret = i;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+size_t (ary_count)(struct aryb *ary, size_t start, const void *data,
+                   ary_cmpcb_t comp)
+{
+	size_t i, count = 0;
+	char *elem = (char *)ary->buf + (start * ary->sz);
+
+	if (start >= ary->len)
+		return 0;
+	if (!comp)
+		return ary_memcount(elem, ary->len - start, data, ary->sz);
+	for (i = start; i < ary->len; i++, elem += ary->sz)
+		count += !comp(elem, data);
+	return count;
+}
+
+int (ary_indexall)(struct aryb *ary, struct aryb *ret, size_t start,
+                   const void *data, ary_cmpcb_t comp)
+{
+	size_t i;
+
+	for (i = start; (ary_index)(ary, &i, i, data, comp); i++) {
+		if (!(ary_grow)(ret, 1))
+			return 0;
+		((size_t *)ret->buf)[ret->len++] = i;
+	}
+	return 1;
+}
+
+/* swap the `sz` bytes at `a` and `b`, which don't overlap */
+static inline void ary_swapmem(void *a, void *b, size_t sz)
+{
+	unsigned char tmp[64];
+	char *p = a, *q = b;
+	size_t n;
+
+#define ARY_SWAP_CASE(n)                   \
+	case n:                            \
+		memcpy(tmp, p, n);         \
+		memcpy(p, q, n);           \
+		memcpy(q, tmp, n);         \
+		return
+	switch (sz) {
+	ARY_SWAP_CASE(1);
+	ARY_SWAP_CASE(2);
+	ARY_SWAP_CASE(4);
+	ARY_SWAP_CASE(8);
+	ARY_SWAP_CASE(16);
+	}
+#undef ARY_SWAP_CASE
+	for (; sz; sz -= n, p += n, q += n) {
+		n = (sz < sizeof(tmp)) ? sz : sizeof(tmp);
+		memcpy(tmp, p, n);
+		memcpy(p, q, n);
+		memcpy(q, tmp, n);
+	}
+}
+
+#ifdef ARY_HAVE_SSE2
+/* reverse the 16 / `sz` elements of a vector */
+#define ARY_REV16(x) (x)
+#define ARY_REV8(x) _mm_shuffle_epi32((x), 0x4e)
+#define ARY_REV4(x) _mm_shuffle_epi32((x), 0x1b)
+#define ARY_REV2(x) \
+	ARY_REV8(_mm_shufflehi_epi16(_mm_shufflelo_epi16((x), 0x1b), 0x1b))
+#define ARY_REV1(x) \
+	_mm_or_si128(_mm_slli_epi16(ARY_REV2(x), 8), \
+	             _mm_srli_epi16(ARY_REV2(x), 8))
+
+#define ARY_REVERSE_LOOP(rev)                                          \
+	for (; *hi - *lo >= 32; *lo += 16, *hi -= 16) {                \
+		__m128i x = _mm_loadu_si128((__m128i *)*lo);           \
+		__m128i y = _mm_loadu_si128((__m128i *)(*hi - 16));    \
+		_mm_storeu_si128((__m128i *)*lo, rev(y));              \
+		_mm_storeu_si128((__m128i *)(*hi - 16), rev(x));       \
+	}                                                              \
+	break
+
+/* reverse the outer parts of the elements from `*lo` to `*hi` (exclusive) a
+ * vector from each end at a time, leaves less than 32 bytes in between */
+static void ary_reverse_sse2(char **lo, char **hi, size_t sz)
+{
+	switch (sz) {
+	case 1:
+		ARY_REVERSE_LOOP(ARY_REV1);
+	case 2:
+		ARY_REVERSE_LOOP(ARY_REV2);
+	case 4:
+		ARY_REVERSE_LOOP(ARY_REV4);
+	case 8:
+		ARY_REVERSE_LOOP(ARY_REV8);
+	case 16:
+		ARY_REVERSE_LOOP(ARY_REV16);
+	}
+}
+#endif
+
+/* reverse the `n` elements of `sz` bytes at `buf` */
+static void ary_reversemem(char *buf, size_t n, size_t sz)
+{
+	char *lo = buf, *hi = buf + (n * sz);
+
+	if (n < 2)
+		return;
+#ifdef ARY_HAVE_SSE2
+	ary_reverse_sse2(&lo, &hi, sz);
+#endif
+	for (hi -= sz; lo < hi; lo += sz, hi -= sz)
+		ary_swapmem(lo, hi, sz);
+}
+
+int (ary_reverse)(struct aryb *ary)
+{
+	ary->flags |= ARY_STALE;
+	ary_reversemem(ary->buf, ary->len, ary->sz);
+	return 1;
+}
+
+/* rotations with a smaller part than this (in bytes) are done with a copy of
+ * that part on the stack */
+#define ARY_ROTATE_STACK 256
+
+void (ary_rotate)(struct aryb *ary, size_t n)
+{
+	unsigned char tmp[ARY_ROTATE_STACK];
+	char *buf = ary->buf;
+	size_t sz = ary->sz, len = ary->len;
+
+	if (!len || !(n %= len))
+		return;
+	ary->flags |= ARY_STALE;
+	if (n * sz <= sizeof(tmp)) {
+		memcpy(tmp, buf, n * sz);
+		memmove(buf, buf + (n * sz), (len - n) * sz);
+		memcpy(buf + ((len - n) * sz), tmp, n * sz);
+	} else if ((len - n) * sz <= sizeof(tmp)) {
+		memcpy(tmp, buf + (n * sz), (len - n) * sz);
+		memmove(buf + ((len - n) * sz), buf, n * sz);
+		memcpy(buf, tmp, (len - n) * sz);
+	} else {
+		ary_reversemem(buf, n, sz);
+		ary_reversemem(buf + (n * sz), len - n, sz);
+		ary_reversemem(buf, len, sz);
+	}
+}
+
+uint64_t ary_cb_splitmix64(void *state)
+{
+	uint64_t z = (*(uint64_t *)state += 0x9e3779b97f4a7c15ULL);
+
+	z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+	return z ^ (z >> 31);
+}
+
+/* state of ary_shuffle() without one */
+static uint64_t ary_shufflestate = 0x853c49e6748fea9bULL;
+
+void (ary_shuffle)(struct aryb *ary, ary_randcb_t rnd, void *state)
+{
+	char *buf = ary->buf;
+	size_t sz = ary->sz, i, j;
+	uint64_t r;
+
+	if (!rnd)
+		rnd = ary_cb_splitmix64;
+	if (!state)
+		state = &ary_shufflestate;
+	if (ary->len < 2)
+		return;
+	ary->flags |= ARY_STALE;
+	for (i = ary->len - 1; i; i--) {
+		r = rnd(state);
+		/* map the upper half to [0, i] without a division, unless the
+		 * array is too long for that */
+		if (i < UINT32_MAX)
+			j = (size_t)(((r >> 32) * (i + 1)) >> 32);
+		else
+			j = (size_t)(r % ((uint64_t)i + 1));
+		if (i != j)
+			ary_swapmem(buf + (i * sz), buf + (j * sz), sz);
+	}
+}
+
+int (ary_join)(struct aryb *ary, char **ret, const char *sep,
+               ary_joincb_t stringify)
+{
+	struct ary_char strbuf;
+	char *elem = (char *)ary->buf, *tmp;
+	size_t seplen = sep ? strlen(sep) : 0, i, len;
+	int tmplen, tmpret;
+
+	if (!ary_init(&strbuf, 1024))
+		goto error;
+	for (i = 0; i < ary->len; i++, elem += ary->sz) {
+		if (stringify) {
+			tmplen = stringify(&tmp, elem);
+			if (tmplen > 0) {
+				tmpret = ary_splice(&strbuf, strbuf.len, 0,
+				                    tmp, tmplen);
+				ary_xfree(tmp);
+				if (!tmpret)
+					goto error;
+			} else if (!tmplen) {
+				ary_xfree(tmp);
+			}
+		} else {
+			tmp = *(char **)elem;
+			if (!tmp)
+				continue;
+			if (!ary_splice(&strbuf, strbuf.len, 0, tmp,
+			                strlen(tmp)))
+				goto error;
+		}
+		if (seplen) {
+			if (!ary_splice(&strbuf, strbuf.len, 0, sep, seplen))
+				goto error;
+		}
+	}
+	if (!strbuf.len) {
+		if (!(*ret = strdup("")))
+			goto error;
+		return 0;
+	}
+	ary_setlen(&strbuf, strbuf.len - seplen + 1);
+	strbuf.buf[strbuf.len - 1] = '\0';
+	ary_shrinktofit(&strbuf);
+	*ret = ary_detach(&strbuf, &len);
+	return (int)len;
+
+error:
+	ary_release(&strbuf);
+	*ret = NULL;
+	return -1;
+}
+
+int (ary_join_append)(struct aryb *ary, struct ary_char *out, const char *sep,
+                      ary_appendcb_t append, size_t hint)
+{
+	char *elem = (char *)ary->buf, *str = NULL;
+	size_t seplen = sep ? strlen(sep) : 0, origlen = out->len, i;
+	int first = 1;
+
+	/* a hint too large to multiply out is just ignored */
+	if (hint && ary->len && hint + seplen <= (SIZE_MAX - 1) / ary->len &&
+	    !ary_grow(out, ary->len * (hint + seplen) + 1))
+		return 0;
+	for (i = 0; i < ary->len; i++, elem += ary->sz) {
+		/* like ary_join(), skip NULL-strings and their separator */
+		if (!append && !(str = *(char **)elem))
+			continue;
+		if (!first && seplen && !ary_appendmem(out, sep, seplen))
+			goto error;
+		first = 0;
+		if (append ? !append(out, elem) :
+		             !ary_appendmem(out, str, strlen(str)))
+			goto error;
+	}
+	if (!ary_grow(out, 1))
+		goto error;
+	out->buf[out->len] = '\0';
+	return 1;
+
+error:
+	out->len = out->s.len = origlen;
+	return 0;
+}
+
+int (ary_swap)(struct aryb *ary, size_t a, size_t b)
+{
+	if (a >= ary->len)
+		a = ary->len - 1;
+	if (b >= ary->len)
+		b = ary->len - 1;
+	if (a == b)
+		return 1;
+	ary->flags |= ARY_STALE;
+	ary_swapmem((char *)ary->buf + (a * ary->sz),
+	            (char *)ary->buf + (b * ary->sz), ary->sz);
+	return 1;
+}
+
+#ifdef __GNUC__
+#define ARY_PREFETCH(ptr) __builtin_prefetch(ptr)
+#else
+#define ARY_PREFETCH(ptr) (void)(ptr)
+#endif
+
+/* define a branchless binary search over `n` elements for the first one that
+ * `before(elem, key)` is false for; both possible next probes are prefetched,
+ * which hides the cache misses of large arrays */
+#define ARY_BOUND_DEFINE(name, type, before)                                   \
+	static size_t name(const type *buf, size_t n, type key)                \
+	{                                                                      \
+		const type *base = buf;                                        \
+		size_t half;                                                   \
+                                                                               \
+		if (!n)                                                        \
+			return 0;                                              \
+		while (n > 1) {                                                \
+			half = n / 2;                                          \
+			ARY_PREFETCH(base + half / 2);                         \
+			ARY_PREFETCH(base + half + half / 2);                  \
+			base = before(base[half], key) ? base + half : base;   \
+			n -= half;                                             \
+		}                                                              \
+		return (size_t)(base - buf) + before(*base, key);              \
+	}
+
+#define ARY_LOWER(elem, key) ((elem) < (key))
+#define ARY_UPPER(elem, key) (!((key) < (elem)))
+
+ARY_BOUND_DEFINE(ary_lower_int, int, ARY_LOWER)
+ARY_BOUND_DEFINE(ary_upper_int, int, ARY_UPPER)
+ARY_BOUND_DEFINE(ary_lower_long, long, ARY_LOWER)
+ARY_BOUND_DEFINE(ary_upper_long, long, ARY_UPPER)
+ARY_BOUND_DEFINE(ary_lower_vlong, long long, ARY_LOWER)
+ARY_BOUND_DEFINE(ary_upper_vlong, long long, ARY_UPPER)
+ARY_BOUND_DEFINE(ary_lower_size_t, size_t, ARY_LOWER)
+ARY_BOUND_DEFINE(ary_upper_size_t, size_t, ARY_UPPER)
+ARY_BOUND_DEFINE(ary_lower_double, double, ARY_LOWER)
+ARY_BOUND_DEFINE(ary_upper_double, double, ARY_UPPER)
+
+/* get the position of the first of the `n` elements at `buf` that isn't less
+ * than `data`, or with `upper` set, that is greater than `data` */
+static size_t ary_bound(const char *buf, size_t n, size_t sz, const void *data,
+                        ary_cmpcb_t comp, int upper)
+{
+	const char *base = buf;
+	size_t half;
+
+	/* the builtin comparisons get inlined */
+	if (comp == ary_cb_cmpint)
+		return upper ? ary_upper_int((const int *)buf, n,
+		                             *(const int *)data) :
+		               ary_lower_int((const int *)buf, n,
+		                             *(const int *)data);
+	if (comp == ary_cb_cmplong)
+		return upper ? ary_upper_long((const long *)buf, n,
+		                              *(const long *)data) :
+		               ary_lower_long((const long *)buf, n,
+		                              *(const long *)data);
+	if (comp == ary_cb_cmpvlong)
+		return upper ? ary_upper_vlong((const long long *)buf, n,
+		                               *(const long long *)data) :
+		               ary_lower_vlong((const long long *)buf, n,
+		                               *(const long long *)data);
+	if (comp == ary_cb_cmpsize_t)
+		return upper ? ary_upper_size_t((const size_t *)buf, n,
+		                                *(const size_t *)data) :
+		               ary_lower_size_t((const size_t *)buf, n,
+		                                *(const size_t *)data);
+	if (comp == ary_cb_cmpdouble)
+		return upper ? ary_upper_double((const double *)buf, n,
+		                                *(const double *)data) :
+		               ary_lower_double((const double *)buf, n,
+		                                *(const double *)data);
+	if (!n)
+		return 0;
+	/* elements before the bound compare below 0, or below 1 if `upper` */
+	while (n > 1) {
+		half = n / 2;
+		ARY_PREFETCH(base + (half / 2) * sz);
+		ARY_PREFETCH(base + (half + half / 2) * sz);
+		if (comp(base + half * sz, data) < upper)
+			base += half * sz;
+		n -= half;
+	}
+	return (size_t)(base - buf) / sz + (comp(base, data) < upper);
+}
+
+int (ary_search)(struct aryb *ary, size_t *ret, size_t start, const void *data,
+                 ary_cmpcb_t comp)
+{
+	char *elem = (char *)ary->buf + (start * ary->sz);
+	size_t pos;
+
+	if (start >= ary->len)
+		return 0;
+	pos = start + ary_bound(elem, ary->len - start, ary->sz, data, comp, 0);
+	if (pos == ary->len ||
+	    comp((char *)ary->buf + (pos * ary->sz), data))
+		return 0;
+	if (ret)
+		*ret = pos;
+	return 1;
+}
+
+size_t (ary_lower_bound)(struct aryb *ary, const void *data, ary_cmpcb_t comp)
+{
+	return ary_bound(ary->buf, ary->len, ary->sz, data, comp, 0);
+}
+
+size_t (ary_upper_bound)(struct aryb *ary, const void *data, ary_cmpcb_t comp)
+{
+	return ary_bound(ary->buf, ary->len, ary->sz, data, comp, 1);
+}
+
+size_t (ary_equal_range)(struct aryb *ary, size_t *lo, size_t *hi,
+                         const void *data, ary_cmpcb_t comp)
+{
+	size_t first = ary_bound(ary->buf, ary->len, ary->sz, data, comp, 0);
+	size_t last = first + ary_bound((char *)ary->buf + (first * ary->sz),
+	                                ary->len - first, ary->sz, data, comp,
+	                                1);
+
+	if (lo)
+		*lo = first;
+	if (hi)
+		*hi = last;
+	return last - first;
+}
+
+int (ary_insert_sorted)(struct aryb *ary, const void *data, ary_cmpcb_t comp)
+{
+	uintptr_t src = (uintptr_t)data, buf = (uintptr_t)ary->buf;
+	int inside = src >= buf && src < buf + (ary->len * ary->sz);
+	size_t pos = ary_bound(ary->buf, ary->len, ary->sz, data, comp, 1);
+	size_t off = src - buf;
+	void *ptr = (ary_splicep)(ary, pos, 0, 1);
+
+	if (!ptr)
+		return 0;
+	/* like ary_extend(), find `data` in the possibly moved buffer, it's
+	 * behind the new slot if it was at or after `pos` */
+	if (inside)
+		data = (char *)ary->buf + off + ((off >= pos * ary->sz) ?
+		                                 ary->sz : 0);
+	memcpy(ptr, data, ary->sz);
+	return 1;
+}
+
+int (ary_merge_sorted)(struct aryb *a, struct aryb *b, struct aryb *ret,
+                       ary_cmpcb_t comp)
+{
+	const char *x = a->buf, *y = b->buf, *xend, *yend, *run;
+	size_t sz = a->sz;
+	char *out;
+
+	if (a->len > SIZE_MAX - b->len || !(ary_grow)(ret, a->len + b->len))
+		return 0;
+	out = ret->buf;
+	xend = x + a->len * sz;
+	yend = y + b->len * sz;
+	/* copy whole runs, ties are taken from `a` first */
+	while (x < xend && y < yend) {
+		for (run = x; run < xend && comp(y, run) >= 0; run += sz)
+			;
+		memcpy(out, x, run - x);
+		out += run - x;
+		x = run;
+		if (x == xend)
+			break;
+		for (run = y; run < yend && comp(run, x) < 0; run += sz)
+			;
+		memcpy(out, y, run - y);
+		out += run - y;
+		y = run;
+	}
+	if (x < xend)
+		memcpy(out, x, xend - x);
+	if (y < yend)
+		memcpy(out + (xend - x), y, yend - y);
+	ret->len = a->len + b->len;
+	return 1;
+}
+
+/* what ary_setcombine() keeps: elements only in `a`, only in `b` and in both */
+#define ARY_SET_A 0x1
+#define ARY_SET_B 0x2
+#define ARY_SET_AB 0x4
+
+/* gallop through runs if one set is at least this many times larger */
+#define ARY_GALLOP_RATIO 16
+
+/* define a merge of the sorted sets `a` and `b` that keeps what `mode` says,
+ * `elem(buf, i)` points to the i-th element, `cmp(x, y)` compares two elements
+ * and `bound(buf, n, key, upper)` is like ary_bound(); if `gallop` is set the
+ * runs of elements only in one set are skipped by exponential search */
+#define ARY_SETOP_DEFINE(name, type, elem, cmp, bound)                         \
+	static size_t name(const type *a, size_t na, const type *b, size_t nb, \
+	                   type *out, size_t sz, ary_cmpcb_t comp, int mode)   \
+	{                                                                      \
+		size_t i = 0, j = 0, k = 0, run, lo, hi;                       \
+		int c, gallop = (na / ARY_GALLOP_RATIO > nb ||                 \
+		                 nb / ARY_GALLOP_RATIO > na);                  \
+                                                                               \
+		(void)sz;                                                      \
+		(void)comp;                                                    \
+		while (i < na && j < nb) {                                     \
+			c = cmp(elem(a, i), elem(b, j));                       \
+			if (!c) {                                              \
+				if (mode & ARY_SET_AB)                         \
+					memcpy(elem(out, k++), elem(a, i), sz);\
+				i++;                                           \
+				j++;                                           \
+				continue;                                      \
+			}                                                      \
+			/* find the run of elements below the other set's */  \
+			run = 1;                                               \
+			if (gallop) {                                          \
+				const type *x = (c < 0) ? elem(a, i) :         \
+				                          elem(b, j);          \
+				const type *y = (c < 0) ? elem(b, j) :         \
+				                          elem(a, i);          \
+				size_t n = (c < 0) ? na - i : nb - j;          \
+                                                                               \
+				for (lo = 0, hi = 1; hi < n &&                 \
+				     cmp(elem(x, hi - 1), y) < 0; hi *= 2)     \
+					lo = hi;                               \
+				if (hi > n)                                    \
+					hi = n;                                \
+				run = lo + bound(elem(x, lo), hi - lo, y, 0);  \
+			}                                                      \
+			if (c < 0) {                                           \
+				if (mode & ARY_SET_A) {                        \
+					memcpy(elem(out, k), elem(a, i),       \
+					       run * sz);                      \
+					k += run;                              \
+				}                                              \
+				i += run;                                      \
+			} else {                                               \
+				if (mode & ARY_SET_B) {                        \
+					memcpy(elem(out, k), elem(b, j),       \
+					       run * sz);                      \
+					k += run;                              \
+				}                                              \
+				j += run;                                      \
+			}                                                      \
+		}                                                              \
+		if (i < na && (mode & ARY_SET_A)) {                            \
+			memcpy(elem(out, k), elem(a, i), (na - i) * sz);       \
+			k += na - i;                                           \
+		}                                                              \
+		if (j < nb && (mode & ARY_SET_B)) {                            \
+			memcpy(elem(out, k), elem(b, j), (nb - j) * sz);       \
+			k += nb - j;                                           \
+		}                                                              \
+		return k;                                                      \
+	}
+
+#define ARY_ELEMPTR(buf, i) ((buf) + (i))
+#define ARY_ELEMBYTES(buf, i) ((buf) + (i) * sz)
+#define ARY_CMPVAL(x, y) ((*(x) > *(y)) - (*(x) < *(y)))
+#define ARY_CMPCB(x, y) comp((x), (y))
+#define ARY_BOUNDCB(buf, n, key, upper) \
+	ary_bound((buf), (n), sz, (key), comp, (upper))
+#define ARY_BOUNDINT(buf, n, key, upper) ary_lower_int((buf), (n), *(key))
+#define ARY_BOUNDVLONG(buf, n, key, upper) ary_lower_vlong((buf), (n), *(key))
+
+ARY_SETOP_DEFINE(ary_setop_cb, char, ARY_ELEMBYTES, ARY_CMPCB, ARY_BOUNDCB)
+ARY_SETOP_DEFINE(ary_setop_int, int, ARY_ELEMPTR, ARY_CMPVAL, ARY_BOUNDINT)
+ARY_SETOP_DEFINE(ary_setop_vlong, long long, ARY_ELEMPTR, ARY_CMPVAL,
+                 ARY_BOUNDVLONG)
+
+#ifdef ARY_HAVE_SSE2
+/* check whether the `n` elements at `buf` are strictly increasing */
+#define ARY_STRICT_DEFINE(name, type)                             \
+	static int name(const type *buf, size_t n)                \
+	{                                                         \
+		size_t i;                                         \
+		int ok = 1;                                       \
+                                                                  \
+		for (i = 1; i < n; i++)                           \
+			ok &= buf[i - 1] < buf[i];                \
+		return ok;                                        \
+	}
+
+ARY_STRICT_DEFINE(ary_strict_int, int)
+ARY_STRICT_DEFINE(ary_strict_vlong, long long)
+
+/* intersect strictly increasing sets by comparing blocks of 4 elements of
+ * `a` with all rotations of a block of `b`; a block is done once the other's
+ * block reaches its maximum */
+static size_t ary_intersect_int_sse2(const int *a, size_t na, const int *b,
+                                     size_t nb, int *out)
+{
+	size_t i = 0, j = 0, k = 0;
+	int amax, bmax;
+	__m128i va, vb, eq;
+	unsigned m;
+
+	while (i + 4 <= na && j + 4 <= nb) {
+		va = _mm_loadu_si128((const __m128i *)(a + i));
+		vb = _mm_loadu_si128((const __m128i *)(b + j));
+		eq = _mm_or_si128(_mm_cmpeq_epi32(va, vb),
+		                  _mm_cmpeq_epi32(va, _mm_shuffle_epi32(vb, 0x39)));
+		eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va,
+		                                      _mm_shuffle_epi32(vb, 0x4e)));
+		eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va,
+		                                      _mm_shuffle_epi32(vb, 0x93)));
+		for (m = (unsigned)_mm_movemask_ps(_mm_castsi128_ps(eq)); m;
+		     m &= m - 1)
+			out[k++] = a[i + __builtin_ctz(m)];
+		amax = a[i + 3];
+		bmax = b[j + 3];
+		i += (amax <= bmax) ? 4 : 0;
+		j += (bmax <= amax) ? 4 : 0;
+	}
+	return k + ary_setop_int(a + i, na - i, b + j, nb - j, out + k,
+	                         sizeof(int), NULL, ARY_SET_AB);
+}
+
+/* compare 64-bit lanes with SSE2's 32-bit compare */
+static inline __m128i ary_cmpeq_epi64(__m128i x, __m128i y)
+{
+	__m128i eq = _mm_cmpeq_epi32(x, y);
+
+	return _mm_and_si128(eq, _mm_shuffle_epi32(eq, 0xb1));
+}
+
+/* like ary_intersect_int_sse2(), but with blocks of 2 elements */
+static size_t ary_intersect_vlong_sse2(const long long *a, size_t na,
+                                       const long long *b, size_t nb,
+                                       long long *out)
+{
+	size_t i = 0, j = 0, k = 0;
+	long long amax, bmax;
+	__m128i va, vb, eq;
+	unsigned m;
+
+	while (i + 2 <= na && j + 2 <= nb) {
+		va = _mm_loadu_si128((const __m128i *)(a + i));
+		vb = _mm_loadu_si128((const __m128i *)(b + j));
+		eq = _mm_or_si128(ary_cmpeq_epi64(va, vb),
+		                  ary_cmpeq_epi64(va, _mm_shuffle_epi32(vb,
+		                                                        0x4e)));
+		for (m = (unsigned)_mm_movemask_pd(_mm_castsi128_pd(eq)); m;
+		     m &= m - 1)
+			out[k++] = a[i + __builtin_ctz(m)];
+		amax = a[i + 1];
+		bmax = b[j + 1];
+		i += (amax <= bmax) ? 2 : 0;
+		j += (bmax <= amax) ? 2 : 0;
+	}
+	return k + ary_setop_vlong(a + i, na - i, b + j, nb - j, out + k,
+	                           sizeof(long long), NULL, ARY_SET_AB);
+}
+#endif
+
+/* combine two sorted arrays into `ret` according to `mode` */
+static int ary_setcombine(struct aryb *a, struct aryb *b, struct aryb *ret,
+                          ary_cmpcb_t comp, int mode)
+{
+	size_t max = 0, na = a->len, nb = b->len;
+
+	if (mode & ARY_SET_A)
+		max += na;
+	if (mode & ARY_SET_B) {
+		if (nb > SIZE_MAX - max)
+			return 0;
+		max += nb;
+	}
+	if ((mode & ARY_SET_AB) && !(mode & ARY_SET_A))
+		max += (na < nb) ? na : nb;
+	if (!max)
+		return 1;
+	if (!(ary_grow)(ret, max))
+		return 0;
+	if (comp == ary_cb_cmpint) {
+#ifdef ARY_HAVE_SSE2
+		if (mode == ARY_SET_AB && na / ARY_GALLOP_RATIO <= nb &&
+		    nb / ARY_GALLOP_RATIO <= na && ary_strict_int(a->buf, na) &&
+		    ary_strict_int(b->buf, nb)) {
+			ret->len = ary_intersect_int_sse2(a->buf, na, b->buf,
+			                                  nb, ret->buf);
+			return 1;
+		}
+#endif
+		ret->len = ary_setop_int(a->buf, na, b->buf, nb, ret->buf,
+		                         sizeof(int), comp, mode);
+	} else if (comp == ary_cb_cmpvlong) {
+#ifdef ARY_HAVE_SSE2
+		if (mode == ARY_SET_AB && na / ARY_GALLOP_RATIO <= nb &&
+		    nb / ARY_GALLOP_RATIO <= na &&
+		    ary_strict_vlong(a->buf, na) &&
+		    ary_strict_vlong(b->buf, nb)) {
+			ret->len = ary_intersect_vlong_sse2(a->buf, na, b->buf,
+			                                    nb, ret->buf);
+			return 1;
+		}
+#endif
+		ret->len = ary_setop_vlong(a->buf, na, b->buf, nb, ret->buf,
+		                           sizeof(long long), comp, mode);
+	} else {
+		ret->len = ary_setop_cb(a->buf, na, b->buf, nb, ret->buf,
+		                        a->sz, comp, mode);
+	}
+	return 1;
+}
+
+int (ary_set_union)(struct aryb *a, struct aryb *b, struct aryb *ret,
+                    ary_cmpcb_t comp)
+{
+	return ary_setcombine(a, b, ret, comp,
+	                      ARY_SET_A | ARY_SET_B | ARY_SET_AB);
+}
+
+int (ary_set_intersect)(struct aryb *a, struct aryb *b, struct aryb *ret,
+                        ary_cmpcb_t comp)
+{
+	return ary_setcombine(a, b, ret, comp, ARY_SET_AB);
+}
+
+int (ary_set_difference)(struct aryb *a, struct aryb *b, struct aryb *ret,
+                         ary_cmpcb_t comp)
+{
+	return ary_setcombine(a, b, ret, comp, ARY_SET_A);
+}
+
+int (ary_set_symdiff)(struct aryb *a, struct aryb *b, struct aryb *ret,
+                      ary_cmpcb_t comp)
+{
+	return ary_setcombine(a, b, ret, comp, ARY_SET_A | ARY_SET_B);
+}
+
+/* stable bottom-up mergesort of the positions in `idx` by the elements they
+ * refer to, `tmp` has to be able to hold `n` positions too; returns whichever
+ * of both buffers ended up holding the sorted positions */
+static size_t *ary_sortidx(size_t *idx, size_t *tmp, size_t n, const char *buf,
+                           size_t sz, ary_cmpcb_t comp)
+{
+	const size_t run = 8;
+	size_t *src = idx, *dst = tmp, *swp, width, lo, mid, hi, i, j, k;
+
+	for (lo = 0; lo < n; lo += run) {
+		hi = (n - lo < run) ? n : lo + run;
+		for (i = lo + 1; i < hi; i++) {
+			size_t pos = idx[i];
+
+			for (j = i; j > lo &&
+			     comp(buf + idx[j - 1] * sz, buf + pos * sz) > 0; j--)
+				idx[j] = idx[j - 1];
+			idx[j] = pos;
+		}
+	}
+	for (width = run; width < n; width *= 2) {
+		for (lo = 0; lo < n; lo += 2 * width) {
+			mid = (n - lo < width) ? n : lo + width;
+			hi = (n - mid < width) ? n : mid + width;
+			for (i = lo, j = mid, k = lo; k < hi; k++) {
+				if (j == hi || (i < mid &&
+				    comp(buf + src[i] * sz, buf + src[j] * sz) <= 0))
+					dst[k] = src[i++];
+				else
+					dst[k] = src[j++];
+			}
+		}
+		swp = src;
+		src = dst;
+		dst = swp;
+	}
+	return src;
+}
+
+int (ary_unique)(struct aryb *ary, ary_cmpcb_t comp)
+{
+	size_t *idx, *sorted, num = ary->len, sz = ary->sz, i, j, k;
+	unsigned char *keep;
+	char *buf = ary->buf;
+
+	if (num < 2)
+		return 1;
+	idx = ary_xrealloc(NULL, num, 2 * sizeof(*idx));
+	if (!idx)
+		return 0;
+	ary->flags |= ARY_STALE;
+	for (i = 0; i < num; i++)
+		idx[i] = i;
+	sorted = ary_sortidx(idx, idx + num, num, buf, sz, comp);
+	/* the sort is stable, so the first element of every group of equal
+	 * elements is also its first occurrence in the array */
+	keep = (unsigned char *)((sorted == idx) ? idx + num : idx);
+	keep[sorted[0]] = 1;
+	for (i = 1; i < num; i++)
+		keep[sorted[i]] = !!comp(buf + sorted[i - 1] * sz,
+		                         buf + sorted[i] * sz);
+	for (i = j = 0; i < num; i = k) {
+		for (k = i; k < num && keep[k]; k++)
+			;
+		if (k > i) {
+			if (i != j)
+				memmove(buf + j * sz, buf + i * sz, (k - i) * sz);
+			j += k - i;
+		}
+		for (i = k; k < num && !keep[k]; k++)
+			;
+		if (k > i && (ary->dtor || ary->rdtor))
+			ary_destruct(ary, buf + i * sz, k - i);
+	}
+	ary->len = j;
+	ary_xfree(idx);
+	return 1;
+}
+
+void (ary_unique_sorted)(struct aryb *ary, ary_cmpcb_t comp)
+{
+	size_t sz = ary->sz, i, j;
+	char *buf = ary->buf;
+
+	ary->flags |= ARY_STALE;
+	for (i = j = 1; i < ary->len; i++) {
+		char *elem = buf + i * sz;
+
+		if (!comp(buf + (j - 1) * sz, elem)) {
+			if (ary->dtor || ary->rdtor)
+				ary_destruct(ary, elem, 1);
+		} else {
+			if (i != j)
+				memcpy(buf + j * sz, elem, sz);
+			j++;
+		}
+	}
+	if (ary->len)
+		ary->len = j;
+}
+
+int (ary_argsort)(struct aryb *ary, struct aryb *ret, ary_cmpcb_t comp)
+{
+	size_t n = ary->len, *idx, *sorted, i;
+
+	if (!n)
+		return 1;
+	if (!(ary_grow)(ret, n))
+		return 0;
+	idx = ary_xrealloc(NULL, n, 2 * sizeof(*idx));
+	if (!idx)
+		return 0;
+	for (i = 0; i < n; i++)
+		idx[i] = i;
+	sorted = ary_sortidx(idx, idx + n, n, ary->buf, ary->sz, comp);
+	memcpy((size_t *)ret->buf + ret->len, sorted, n * sizeof(*idx));
+	ret->len += n;
+	ary_xfree(idx);
+	return 1;
+}
+
+/* copy the `n` elements of `sz` bytes at the positions `pos` of `src` to
+ * `dst` */
+static void ary_gatherpos(char *dst, const char *src, const size_t *pos,
+                          size_t n, size_t sz)
+{
+	size_t i;
+
+#define ARY_GATHER_CASE(k)                                            \
+	case k:                                                       \
+		for (i = 0; i < n; i++)                               \
+			memcpy(dst + i * k, src + pos[i] * k, k);     \
+		return
+	switch (sz) {
+	ARY_GATHER_CASE(1);
+	ARY_GATHER_CASE(2);
+	ARY_GATHER_CASE(4);
+	ARY_GATHER_CASE(8);
+	ARY_GATHER_CASE(16);
+	}
+#undef ARY_GATHER_CASE
+	for (i = 0; i < n; i++)
+		memcpy(dst + i * sz, src + pos[i] * sz, sz);
+}
+
+int ary_soa_sort(struct aryb **cols, size_t ncols, const struct aryb *key,
+                 ary_cmpcb_t comp)
+{
+	size_t n = key->len, *idx, *sorted, maxsz = 0, i;
+	char *tmp;
+
+	if (n < 2)
+		return 1;
+	for (i = 0; i < ncols; i++)
+		if (cols[i]->sz > maxsz)
+			maxsz = cols[i]->sz;
+	idx = ary_xrealloc(NULL, n, 2 * sizeof(*idx));
+	if (!idx)
+		return 0;
+	tmp = ary_xrealloc(NULL, n, maxsz);
+	if (!tmp) {
+		ary_xfree(idx);
+		return 0;
+	}
+	for (i = 0; i < n; i++)
+		idx[i] = i;
+	sorted = ary_sortidx(idx, idx + n, n, key->buf, key->sz, comp);
+	/* permute one column after another, so only a single temporary column
+	 * is needed */
+	for (i = 0; i < ncols; i++) {
+		ary_gatherpos(tmp, cols[i]->buf, sorted, n, cols[i]->sz);
+		memcpy(cols[i]->buf, tmp, n * cols[i]->sz);
+		cols[i]->flags |= ARY_STALE;
+	}
+	ary_xfree(tmp);
+	ary_xfree(idx);
+	return 1;
+}
+
+/* arrays below this length are sorted by a single thread */
+#define ARY_PARALLEL_CUTOFF 65536
+
+/* a part of ary_sort_parallel(): either sort `alen` elements at `a`, or merge
+ * them with `blen` elements at `b` into `dst` */
+struct ary_sortjob {
+	char *a, *b, *dst;
+	size_t alen, blen, sz;
+	ary_cmpcb_t comp;
+};
+
+static void *ary_sortjob_run(void *arg)
+{
+	struct ary_sortjob *job = arg;
+	char *a = job->a, *b = job->b, *dst = job->dst, *aend, *bend;
+
+	if (!dst) {
+		qsort(a, job->alen, job->sz, job->comp);
+		return NULL;
+	}
+	aend = a + job->alen * job->sz;
+	bend = b + job->blen * job->sz;
+	while (a < aend && b < bend) {
+		if (job->comp(a, b) <= 0) {
+			memcpy(dst, a, job->sz);
+			a += job->sz;
+		} else {
+			memcpy(dst, b, job->sz);
+			b += job->sz;
+		}
+		dst += job->sz;
+	}
+	memcpy(dst, a, (size_t)(aend - a));
+	memcpy(dst + (aend - a), b, (size_t)(bend - b));
+	return NULL;
+}
+
+/* run `njobs` (up to 65) jobs of `jobsz` bytes each in parallel, or in the
+ * calling thread if that fails */
+static void ary_runjobs(void *(*run)(void *), void *jobs, size_t jobsz,
+                        size_t njobs)
+{
+	char *job = jobs;
+#ifdef ARY_HAVE_PTHREAD
+	pthread_t threads[65];
+	int started[65];
+	size_t i;
+
+	for (i = 1; i < njobs; i++)
+		started[i] = !pthread_create(&threads[i], NULL, run,
+		                             job + i * jobsz);
+	run(job);
+	for (i = 1; i < njobs; i++) {
+		if (started[i])
+			pthread_join(threads[i], NULL);
+		else
+			run(job + i * jobsz);
+	}
+#else
+	size_t i;
+
+	for (i = 0; i < njobs; i++)
+		run(job + i * jobsz);
+#endif
+}
+
+/* get the number of threads to use, 0 means one per online processor */
+static size_t ary_nthreads(size_t nthreads)
+{
+#ifdef ARY_HAVE_PTHREAD
+	if (!nthreads) {
+		long ret = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nthreads = (ret > 0) ? (size_t)ret : 1;
+	}
+#else
+	nthreads = 1;
+#endif
+	return (nthreads > 64) ? 64 : nthreads;
+}
+
+/* get the number of elements of `a` among the first `diag` elements of the
+ * merge of `a` and `b` (elements of `a` come first on ties) */
+static size_t ary_mergesplit(const char *a, size_t alen, const char *b,
+                             size_t blen, size_t diag, size_t sz,
+                             ary_cmpcb_t comp)
+{
+	size_t lo = (diag > blen) ? diag - blen : 0;
+	size_t hi = (diag < alen) ? diag : alen, mid;
+
+	while (lo < hi) {
+		mid = lo + (hi - lo) / 2;
+		if (comp(a + mid * sz, b + (diag - mid - 1) * sz) <= 0)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	return lo;
+}
+
+void (ary_sort_parallel)(struct aryb *ary, ary_cmpcb_t comp, size_t nthreads)
+{
+	struct ary_sortjob jobs[65];
+	size_t runs[65], nruns, len = ary->len, sz = ary->sz, i, j, k, n;
+	char *src = ary->buf, *dst, *tmp;
+
+	ary->flags |= ARY_STALE;
+	nthreads = ary_nthreads(nthreads);
+	if (len / nthreads < ARY_PARALLEL_CUTOFF / 2)
+		nthreads = len / (ARY_PARALLEL_CUTOFF / 2);
+	if (nthreads < 2 || !(tmp = ary_xrealloc(NULL, len, sz))) {
+		if (len > 1)
+			qsort(ary->buf, len, sz, comp);
+		return;
+	}
+	/* sort `nthreads` runs of about the same length */
+	for (i = 0; i <= nthreads; i++)
+		runs[i] = len / nthreads * i + ((i < len % nthreads) ?
+		                                i : len % nthreads);
+	for (i = 0; i < nthreads; i++) {
+		jobs[i].a = src + runs[i] * sz;
+		jobs[i].alen = runs[i + 1] - runs[i];
+		jobs[i].dst = NULL;
+		jobs[i].sz = sz;
+		jobs[i].comp = comp;
+	}
+	ary_runjobs(ary_sortjob_run, jobs, sizeof(*jobs), nthreads);
+	/* merge pairs of runs, splitting each merge so all threads have an
+	 * equal share of the work */
+	dst = tmp;
+	for (nruns = nthreads; nruns > 1; nruns = (nruns + 1) / 2) {
+		size_t npairs = nruns / 2, per = nthreads / npairs;
+
+		for (i = 0, n = 0; i < nruns; i += 2) {
+			char *a = src + runs[i] * sz;
+			size_t alen = runs[i + 1] - runs[i], blen, total, adiag;
+			char *b;
+
+			if (i + 1 == nruns) {
+				/* the odd run out is just copied */
+				jobs[n].a = a;
+				jobs[n].alen = alen;
+				jobs[n].b = a;
+				jobs[n].blen = 0;
+				jobs[n].dst = dst + runs[i] * sz;
+				n++;
+				continue;
+			}
+			b = src + runs[i + 1] * sz;
+			blen = runs[i + 2] - runs[i + 1];
+			total = alen + blen;
+			for (j = 0, adiag = 0; j < per; j++) {
+				size_t start = total / per * j, anext;
+				size_t diag = total / per * (j + 1);
+
+				if (j + 1 == per)
+					diag += total % per;
+				anext = ary_mergesplit(a, alen, b, blen, diag,
+				                       sz, comp);
+
+				jobs[n].a = a + adiag * sz;
+				jobs[n].alen = anext - adiag;
+				jobs[n].b = b + (start - adiag) * sz;
+				jobs[n].blen = (diag - anext) - (start - adiag);
+				jobs[n].dst = dst + (runs[i] + start) * sz;
+				adiag = anext;
+				n++;
+			}
+		}
+		for (k = 0; k < n; k++) {
+			jobs[k].sz = sz;
+			jobs[k].comp = comp;
+		}
+		ary_runjobs(ary_sortjob_run, jobs, sizeof(*jobs), n);
+		for (i = 0, j = 0; i < nruns; i += 2)
+			runs[j++] = runs[i];
+		runs[j] = len;
+		tmp = src;
+		src = dst;
+		dst = tmp;
+	}
+	if (src != ary->buf) {
+		memcpy(ary->buf, src, len * sz);
+		ary_xfree(src);
+	} else {
+		ary_xfree(dst);
+	}
+}
+
+/* parts smaller than this (in bytes) aren't worth a thread of ary_gather() */
+#define ARY_GATHER_CUTOFF (1 << 20)
+
+/* the array `i` of ary_gather()'s `parts` */
+#define ARY_PART(parts, stride, i) \
+	((const struct aryb *)((const char *)(parts) + (i) * (stride)))
+
+/* a part of ary_gather(): copy `bytes` to `dst`, starting at byte `skip` of
+ * the array `first` */
+struct ary_gatherjob {
+	const void *parts;
+	size_t stride, first, skip, bytes;
+	char *dst;
+};
+
+static void *ary_gatherjob_run(void *arg)
+{
+	struct ary_gatherjob *job = arg;
+	const struct aryb *part;
+	size_t k = job->first, skip = job->skip, left = job->bytes, n;
+	char *dst = job->dst;
+
+	for (; left; k++, skip = 0) {
+		part = ARY_PART(job->parts, job->stride, k);
+		if (!(n = part->len * part->sz - skip))
+			continue;
+		if (n > left)
+			n = left;
+		memcpy(dst, (char *)part->buf + skip, n);
+		dst += n;
+		left -= n;
+	}
+	return NULL;
+}
+
+int (ary_gather)(struct aryb *dst, const void *parts, size_t stride, size_t n,
+                 size_t nthreads)
+{
+	struct ary_gatherjob jobs[64];
+	size_t total = 0, bytes, per, left, avail, i, k, skip;
+
+	for (i = 0; i < n; i++) {
+		if (ARY_PART(parts, stride, i)->len > SIZE_MAX - total)
+			return 0;
+		total += ARY_PART(parts, stride, i)->len;
+	}
+	if (!total)
+		return 1;
+	if (total > SIZE_MAX - dst->len || !(ary_grow)(dst, total))
+		return 0;
+	bytes = total * dst->sz;
+	nthreads = ary_nthreads(nthreads);
+	if (nthreads > bytes / ARY_GATHER_CUTOFF)
+		nthreads = bytes / ARY_GATHER_CUTOFF;
+	if (!nthreads)
+		nthreads = 1;
+	/* split the output into ranges of the same size, and find out where
+	 * each one starts in the parts */
+	per = bytes / nthreads;
+	for (i = 0, k = 0, skip = 0; i < nthreads; i++) {
+		jobs[i].parts = parts;
+		jobs[i].stride = stride;
+		jobs[i].first = k;
+		jobs[i].skip = skip;
+		jobs[i].bytes = (i + 1 == nthreads) ? bytes - i * per : per;
+		jobs[i].dst = (char *)dst->buf + (dst->len * dst->sz) + i * per;
+		for (left = jobs[i].bytes; left; k++, skip = 0) {
+			avail = ARY_PART(parts, stride, k)->len * dst->sz - skip;
+			if (avail > left) {
+				skip += left;
+				break;
+			}
+			left -= avail;
 		}
-		memmove(ptr, (char *)ptr + ary->sz, rest);
 	}
-	free(list);
+	ary_runjobs(ary_gatherjob_run, jobs, sizeof(*jobs), nthreads);
+	dst->len += total;
 	return 1;
 }
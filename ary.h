@@ -8,21 +8,78 @@
 #include <string.h>
 #include <strings.h>
 
-#define ARY_GROWTH_FACTOR 2.0
+/* default factor (in percent) the capacity is multiplied with when growing */
+#define ARY_GROWTH_PERCENT 200
+
+/* growth policies, see ary_setgrowth() */
+#define ARY_GROW_GEOMETRIC 0
+#define ARY_GROW_ROUNDED 1
+#define ARY_GROW_CHUNKED 2
+
+/* array flags */
+#define ARY_DEQUE 0x1 /* O(1) removal/insertion at the front */
+#define ARY_STALE 0x2 /* internal: the hash index has to be rebuilt */
 
 /* construct/destruct the element pointed to by `buf` */
 typedef void (*ary_elemcb_t)(void *buf, void *userp);
 
+/* construct/destruct the `n` consecutive elements starting at `first` */
+typedef void (*ary_rangecb_t)(void *first, size_t n, void *userp);
+
 /* the same as the `qsort` comparison function */
 typedef int (*ary_cmpcb_t)(const void *a, const void *b);
 
+/* hash the element pointed to by `elem` of `sz` bytes, elements that compare
+ * equal must have the same hash */
+typedef size_t (*ary_hashcb_t)(const void *elem, size_t sz);
+
+/* return a uniformly distributed random number, `state` is user-defined */
+typedef uint64_t (*ary_randcb_t)(void *state);
+
 /* return a malloc()ed string of `buf` in `ret` and its size, or -1 */
 typedef int (*ary_joincb_t)(char **ret, const void *buf);
 
+/* append the string of `buf` to `out`, return 0 if growing `out` failed */
+struct ary_char;
+typedef int (*ary_appendcb_t)(struct ary_char *out, const void *buf);
+
 typedef void *(*ary_xalloc_t)(void *ptr, size_t nmemb, size_t size);
 typedef void (*ary_xdealloc_t)(void *ptr);
 
-/* struct size: 6x pointers + 4x size_t's + 1x type */
+/* per-array allocator, `ctx` is passed to all routines, `trim` is optional and
+ * gets told that only the first `used` bytes of `ptr` are in use anymore */
+struct ary_allocator {
+	void *(*realloc)(void *ptr, size_t nmemb, size_t size, void *ctx);
+	void (*free)(void *ptr, void *ctx);
+	void *ctx;
+	void (*trim)(void *ptr, size_t used, void *ctx);
+};
+
+struct ary_hidx;
+
+#ifdef ARY_STATS
+/* counters of builds with ARY_STATS defined, see ary_stats() */
+struct ary_stats {
+	size_t grows;  /* reallocations that added capacity */
+	size_t moved;  /* bytes moved within buffers, e.g. by ary_shift() */
+	size_t peak;   /* highest capacity in bytes */
+	size_t wasted; /* unused capacity in bytes */
+	size_t ctors;  /* constructed elements */
+	size_t dtors;  /* destructed elements */
+};
+#endif
+
+#ifdef ARY_TRACE
+/* memory of the arrays initialized at one place, see ary_trace_report() */
+struct ary_tracesite {
+	const char *file;
+	int line;
+	size_t live;  /* estimated bytes of the buffers */
+	size_t grows; /* estimated number of reallocations that added memory */
+};
+#endif
+
+/* struct size: 11x pointers + 7x size_t's + 2x unsigned + 1x type */
 #define ary(type)                                       \
 	{                                               \
 		struct aryb s;                          \
@@ -32,6 +89,17 @@ typedef void (*ary_xdealloc_t)(void *ptr);
 		type val;                               \
 	}
 
+/* like ary(), but the first `n` elements are stored in the struct itself */
+#define ary_sbo(type, n)                                \
+	{                                               \
+		struct aryb s;                          \
+		size_t len;    /* number of elements */ \
+		type *buf;     /* array buffer */       \
+		type *ptr;                              \
+		type val;                               \
+		type inl[n];   /* inline storage */     \
+	}
+
 struct aryb {
 	size_t len;
 	size_t alloc;
@@ -39,9 +107,83 @@ struct aryb {
 	void *buf;
 	ary_elemcb_t ctor;
 	ary_elemcb_t dtor;
+	ary_rangecb_t rctor;  /* preferred over `ctor` if set */
+	ary_rangecb_t rdtor;  /* preferred over `dtor` if set */
 	void *userp;
+	size_t head;    /* unused elements in front of the buffer */
+	unsigned flags;
+	const struct ary_allocator *allocator; /* NULL: ary_xrealloc() */
+	void *inl;      /* inline storage of ary_sbo() arrays */
+	size_t ninl;
+	unsigned growth;
+	size_t growarg;
+	struct ary_hidx *hidx; /* see ary_sethashidx() */
+#ifdef ARY_STATS
+	struct ary_stats stats;
+#endif
+#ifdef ARY_TRACE
+	const char *file; /* where the array was initialized */
+	int line;
+	size_t tracesz;   /* buffer size seen by the tracer */
+	size_t traced;    /* sampled bytes attributed to `file` and `line` */
+#endif
+};
+
+#ifdef ARY_STATS
+#define ARY_STATS_INIT(ary) \
+	(void)memset(&(ary)->s.stats, 0, sizeof((ary)->s.stats))
+#define ARY_STATS_COUNT(ary, field, n) \
+	ary_stats_count((ary), offsetof(struct ary_stats, field), (n))
+#define ARY_STATS_GROWN(ary) ary_stats_grown((ary))
+#else
+#define ARY_STATS_INIT(ary) (void)0
+#define ARY_STATS_COUNT(ary, field, n) (void)0
+#define ARY_STATS_GROWN(ary) (void)0
+#endif
+
+#ifdef ARY_TRACE
+#define ARY_TRACE_INIT(ary)                                                  \
+	((ary)->s.file = __FILE__, (ary)->s.line = __LINE__,                 \
+	 (ary)->s.tracesz = (ary)->s.traced = 0)
+/* inline storage isn't allocated, even if shifted in deque-mode */
+#define ARY_TRACE_RESIZE(ary)                                                \
+	ary_trace_resize((ary),                                              \
+	                 ((char *)(ary)->buf - ((ary)->head * (ary)->sz) !=  \
+	                  (char *)(ary)->inl) ?                              \
+	                 ((ary)->head + (ary)->alloc) * (ary)->sz : 0)
+#define ARY_TRACE_FREE(ary) ary_trace_resize((ary), 0)
+/* keep the call site of a reinitialized array */
+#define ARY_TRACE_SAVE(ary)                       \
+	const char *ary_tracefile = (ary)->s.file; \
+	int ary_traceline = (ary)->s.line
+#define ARY_TRACE_RESTORE(ary) \
+	((ary)->s.file = ary_tracefile, (ary)->s.line = ary_traceline)
+#else
+#define ARY_TRACE_INIT(ary) (void)0
+#define ARY_TRACE_RESIZE(ary) (void)0
+#define ARY_TRACE_FREE(ary) (void)0
+#define ARY_TRACE_SAVE(ary) (void)0
+#define ARY_TRACE_RESTORE(ary) (void)0
+#endif
+
+/* the first segment of a concurrent array holds 2^ARY_CONC_SHIFT elements,
+ * every following one twice as many as the one before */
+#define ARY_CONC_SHIFT 6
+#define ARY_CONC_SEGS (sizeof(size_t) * 8 - ARY_CONC_SHIFT)
+
+struct aryc {
+	size_t len;  /* number of reserved element slots */
+	size_t sz;
+	void *seg[ARY_CONC_SEGS];
 };
 
+/* concurrent array, see ary_conc_init() */
+#define ary_conc(type)                                     \
+	{                                                  \
+		struct aryc s;                             \
+		type *ptr;     /* only its type is used */ \
+	}
+
 /* `struct ary a` is a void *-array */
 struct ary ary(void *);
 /* `struct ary_xyz a` is a xyz-array... */
@@ -56,6 +198,8 @@ struct ary_charptr ary(char *);
 /* predefined callbacks */
 void ary_cb_freevoidptr(void *buf, void *userp);
 void ary_cb_freecharptr(void *buf, void *userp);
+void ary_cb_freevoidptrs(void *first, size_t n, void *userp);
+void ary_cb_freecharptrs(void *first, size_t n, void *userp);
 
 int ary_cb_cmpint(const void *a, const void *b);
 int ary_cb_cmplong(const void *a, const void *b);
@@ -66,6 +210,11 @@ int ary_cb_cmpchar(const void *a, const void *b);
 int ary_cb_strcmp(const void *a, const void *b);
 int ary_cb_strcasecmp(const void *a, const void *b);
 
+size_t ary_cb_hashbytes(const void *elem, size_t sz);
+size_t ary_cb_hashstr(const void *elem, size_t sz);
+
+uint64_t ary_cb_splitmix64(void *state);
+
 int ary_cb_voidptrtostr(char **ret, const void *elem);
 int ary_cb_inttostr(char **ret, const void *elem);
 int ary_cb_longtostr(char **ret, const void *elem);
@@ -74,22 +223,83 @@ int ary_cb_size_ttostr(char **ret, const void *elem);
 int ary_cb_doubletostr(char **ret, const void *elem);
 int ary_cb_chartostr(char **ret, const void *elem);
 
+int ary_cb_appendvoidptr(struct ary_char *out, const void *elem);
+int ary_cb_appendint(struct ary_char *out, const void *elem);
+int ary_cb_appendlong(struct ary_char *out, const void *elem);
+int ary_cb_appendvlong(struct ary_char *out, const void *elem);
+int ary_cb_appendsize_t(struct ary_char *out, const void *elem);
+int ary_cb_appenddouble(struct ary_char *out, const void *elem);
+int ary_cb_appendchar(struct ary_char *out, const void *elem);
+
 /* forward declarations */
 void ary_freebuf(struct aryb *ary);
+void ary_release_async(struct aryb *ary);
+void ary_trim(struct aryb *ary, size_t len);
+void ary_shift(struct aryb *ary);
+void ary_hashidx_trunc(struct aryb *ary, size_t len);
+int ary_sethashidx(struct aryb *ary, ary_hashcb_t hash, ary_cmpcb_t comp);
 void *ary_detach(struct aryb *ary, size_t *ret);
 int ary_shrinktofit(struct aryb *ary);
 void *ary_splicep(struct aryb *ary, size_t pos, size_t rlen, size_t alen);
+void *ary_push_n_uninit(struct aryb *ary, size_t n);
+int ary_push_n(struct aryb *ary, size_t n, const void *val);
+int ary_extend(struct aryb *ary, const void *data, size_t n);
+int ary_gather(struct aryb *dst, const void *parts, size_t stride, size_t n,
+               size_t nthreads);
 int ary_index(struct aryb *ary, size_t *ret, size_t start, const void *data,
               ary_cmpcb_t comp);
 int ary_rindex(struct aryb *ary, size_t *ret, size_t start, const void *data,
                ary_cmpcb_t comp);
+size_t ary_count(struct aryb *ary, size_t start, const void *data,
+                 ary_cmpcb_t comp);
+int ary_indexall(struct aryb *ary, struct aryb *ret, size_t start,
+                 const void *data, ary_cmpcb_t comp);
 int ary_reverse(struct aryb *ary);
+void ary_rotate(struct aryb *ary, size_t n);
+void ary_shuffle(struct aryb *ary, ary_randcb_t rnd, void *state);
 int ary_join(struct aryb *ary, char **ret, const char *sep,
              ary_joincb_t stringify);
+int ary_join_append(struct aryb *ary, struct ary_char *out, const char *sep,
+                    ary_appendcb_t append, size_t hint);
 int ary_swap(struct aryb *ary, size_t a, size_t b);
 int ary_search(struct aryb *ary, size_t *ret, size_t start, const void *data,
                ary_cmpcb_t comp);
+size_t ary_lower_bound(struct aryb *ary, const void *data, ary_cmpcb_t comp);
+size_t ary_upper_bound(struct aryb *ary, const void *data, ary_cmpcb_t comp);
+size_t ary_equal_range(struct aryb *ary, size_t *lo, size_t *hi,
+                       const void *data, ary_cmpcb_t comp);
+int ary_insert_sorted(struct aryb *ary, const void *data, ary_cmpcb_t comp);
+int ary_merge_sorted(struct aryb *a, struct aryb *b, struct aryb *ret,
+                     ary_cmpcb_t comp);
+int ary_set_union(struct aryb *a, struct aryb *b, struct aryb *ret,
+                  ary_cmpcb_t comp);
+int ary_set_intersect(struct aryb *a, struct aryb *b, struct aryb *ret,
+                      ary_cmpcb_t comp);
+int ary_set_difference(struct aryb *a, struct aryb *b, struct aryb *ret,
+                       ary_cmpcb_t comp);
+int ary_set_symdiff(struct aryb *a, struct aryb *b, struct aryb *ret,
+                    ary_cmpcb_t comp);
 int ary_unique(struct aryb *ary, ary_cmpcb_t comp);
+void ary_unique_sorted(struct aryb *ary, ary_cmpcb_t comp);
+int ary_map(struct aryb *ary, const char *path, unsigned flags);
+void ary_sort_parallel(struct aryb *ary, ary_cmpcb_t comp, size_t nthreads);
+int ary_argsort(struct aryb *ary, struct aryb *ret, ary_cmpcb_t comp);
+int ary_soa_sort(struct aryb **cols, size_t ncols, const struct aryb *key,
+                 ary_cmpcb_t comp);
+void ary_sortbuf_int(int *buf, size_t len);
+void ary_sortbuf_long(long *buf, size_t len);
+void ary_sortbuf_vlong(long long *buf, size_t len);
+void ary_sortbuf_size_t(size_t *buf, size_t len);
+void ary_sortbuf_double(double *buf, size_t len);
+void ary_sortbuf_char(char *buf, size_t len);
+int ary_sync(struct aryb *ary);
+void ary_conc_init(struct aryc *c, size_t sz);
+void *ary_conc_pushp(struct aryc *c);
+int ary_conc_push(struct aryc *c, const void *data);
+void *ary_conc_at(struct aryc *c, size_t pos);
+size_t ary_conc_len(struct aryc *c);
+void ary_conc_release(struct aryc *c);
+int ary_conc_freeze(struct aryc *c, struct aryb *ret);
 
 extern ary_xalloc_t ary_xrealloc;
 
@@ -105,6 +315,169 @@ void ary_use_as_realloc(ary_xalloc_t routine);
  */
 void ary_use_as_free(ary_xdealloc_t routine);
 
+#ifdef ARY_STATS
+/* called with the name and value of each counter by ary_stats_export() */
+typedef void (*ary_statscb_t)(const char *name, size_t val, void *userp);
+
+void ary_stats(const struct aryb *ary, struct ary_stats *ret);
+void ary_stats_count(struct aryb *ary, size_t field, size_t n);
+void ary_stats_grown(struct aryb *ary);
+
+/**
+ * ary_stats() - get the counters of an array
+ * @ary: typed pointer to the initialized array
+ * @ret: pointer to the struct that receives the counters
+ *
+ * Only available if ARY_STATS is defined, which has to be the case for ary.c
+ * and everything using it alike. @ret->wasted is the currently unused
+ * capacity. The counters are reset by ary_init() and ary_release().
+ */
+#define ary_stats(ary, ret) \
+	(ary_stats)(&(ary)->s, (ret))
+
+/**
+ * ary_stats_total() - get the counters of all arrays
+ * @ret: pointer to the struct that receives the counters
+ *
+ * @ret->peak is the highest capacity any array had and @ret->wasted the sum of
+ * the capacity that was unused when the arrays were released, all other
+ * counters are summed up over all arrays. Safe to call from any thread.
+ */
+void ary_stats_total(struct ary_stats *ret);
+
+/**
+ * ary_stats_reset() - reset the counters of all arrays
+ *
+ * E.g. to export the counters of an interval. Counts of concurrent operations
+ * are not lost.
+ */
+void ary_stats_reset(void);
+
+/**
+ * ary_stats_export() - pass counters to a metrics system
+ * @stats: pointer to the counters, e.g. from ary_stats_total()
+ * @cb: function that is called with the name and value of each counter
+ * @userp: passed to @cb as is
+ */
+void ary_stats_export(const struct ary_stats *stats, ary_statscb_t cb,
+                      void *userp);
+
+/**
+ * ary_stats_dump() - print the counters of all arrays
+ * @fp: file to print to, one `name value` line per counter
+ */
+void ary_stats_dump(FILE *fp);
+#endif
+
+#ifdef ARY_TRACE
+void ary_trace_resize(struct aryb *ary, size_t bytes);
+
+/**
+ * ary_trace_sample() - set how often the memory of arrays is sampled
+ * @rate: average number of allocated bytes between two samples, 0 or 1 (the
+ *	default) to record every allocation
+ *
+ * Only available if ARY_TRACE is defined, which has to be the case for ary.c
+ * and everything using it alike. Each array then remembers the file and line
+ * of its ary_init() (or of the macro initializing it, e.g. ary_slice()). Every
+ * @rate bytes a buffer grows by, a sample is taken, which attributes @rate
+ * bytes to the call site of the array. Only taking a sample locks. A rate like
+ * 512 KiB keeps the overhead low enough for production use, while the large
+ * arrays, which are the interesting ones, are still sampled reliably.
+ */
+void ary_trace_sample(size_t rate);
+
+/**
+ * ary_trace_report() - get the call sites using the most memory
+ * @ret: array that receives up to @n call sites, ordered by their live bytes
+ * @n: number of elements of @ret
+ *
+ * Call sites stay in the report after their arrays were released, with live
+ * bytes of 0.
+ *
+ * Return: The number of call sites, which can be more than @n, or 0 if
+ *	memory for sorting them couldn't be allocated.
+ */
+size_t ary_trace_report(struct ary_tracesite *ret, size_t n);
+
+/**
+ * ary_trace_dump() - print the call sites using the most memory
+ * @fp: file to print to, one `file:line live grows` line per call site
+ * @n: maximum number of call sites to print
+ */
+void ary_trace_dump(FILE *fp, size_t n);
+#endif
+
+struct ary_arenablk;
+
+/* region allocator, all arrays using it are dropped at once */
+struct ary_arena {
+	struct ary_allocator allocator; /* pass it to ary_init_with_alloc() */
+	struct ary_arenablk *blk;       /* list of blocks, current first */
+	size_t blksz;                   /* default size of new blocks */
+	void *last;                     /* most recent allocation */
+};
+
+/**
+ * ary_arena_init() - initialize an arena
+ * @arena: pointer to the arena
+ * @blksz: size of the memory blocks the arena allocates from, 0 for a default
+ *
+ * Arrays are attached via `ary_init_with_alloc(&a, hint, &@arena->allocator)`.
+ * The most recent allocation of an arena is extended in place as long as its
+ * block has room, so growing the last-grown array doesn't copy it. Releasing
+ * the most recent allocation gives its memory back to the arena, any other
+ * memory is only reclaimed by ary_arena_reset() and ary_arena_release().
+ */
+void ary_arena_init(struct ary_arena *arena, size_t blksz);
+
+/**
+ * ary_arena_reset() - drop all allocations of an arena
+ * @arena: pointer to the initialized arena
+ *
+ * The arrays using @arena are invalid afterwards and must not be released,
+ * reinitialize them with ary_init() or ary_init_with_alloc() instead. Their
+ * destructors are not called. The first block is kept for reuse.
+ */
+void ary_arena_reset(struct ary_arena *arena);
+
+/**
+ * ary_arena_release() - release an arena
+ * @arena: pointer to the initialized arena
+ *
+ * Like ary_arena_reset(), but all memory is given back and @arena has to be
+ * initialized again before it can be used.
+ */
+void ary_arena_release(struct ary_arena *arena);
+
+/* flags of ary_mmap_init() */
+#define ARY_MMAP_HUGEPAGES 0x1 /* use transparent hugepages if available */
+
+/* allocator that maps large buffers to memory directly */
+struct ary_mmap {
+	struct ary_allocator allocator; /* pass it to ary_init_with_alloc() */
+	size_t threshold;
+	unsigned flags;
+};
+
+/**
+ * ary_mmap_init() - initialize an allocator for huge arrays
+ * @mm: pointer to the allocator
+ * @threshold: buffer size in bytes from which on memory is mapped, 0 for a
+ *	default of 16 MiB
+ * @flags: bitwise or of ARY_MMAP_* flags
+ *
+ * Arrays are attached via `ary_init_with_alloc(&a, hint, &@mm->allocator)`.
+ * Buffers below @threshold are allocated with ary_xrealloc(), larger ones are
+ * anonymous memory mappings that grow by remapping their pages (if mremap() is
+ * available), so neither the elements are copied nor the memory is needed
+ * twice. Unused pages are given back to the system when the array shrinks,
+ * i.e. by ary_shrinktofit(), ary_clear() and ary_setlen() if it at least halves
+ * the length. If memory mappings aren't supported, ary_xrealloc() is used for
+ * all buffers.
+ */
+void ary_mmap_init(struct ary_mmap *mm, size_t threshold, unsigned flags);
+
 /**
  * ary_init() - initialize an array
  * @ary: typed pointer to the array
@@ -118,11 +491,117 @@ void ary_use_as_free(ary_xdealloc_t routine);
  */
 #define ary_init(ary, hint)                                 \
 	((ary)->s.alloc = (ary)->s.len = (ary)->len = 0,    \
+	 (ary)->s.head = (ary)->s.flags = 0,                \
 	 (ary)->s.sz = sizeof(*(ary)->buf),                 \
 	 (ary)->s.ctor = (ary)->s.dtor = NULL,              \
+	 (ary)->s.rctor = (ary)->s.rdtor = NULL,            \
 	 (ary)->s.buf = (ary)->s.userp = (ary)->buf = NULL, \
+	 (ary)->s.allocator = (ary)->s.inl = NULL,          \
+	 (ary)->s.hidx = NULL,                              \
+	 ARY_STATS_INIT(ary),                               \
+	 ARY_TRACE_INIT(ary),                               \
+	 (ary)->s.ninl = 0,                                 \
+	 (ary)->s.growth = ARY_GROW_GEOMETRIC,              \
+	 (ary)->s.growarg = ARY_GROWTH_PERCENT,             \
+	 ary_grow((ary), (hint)))
+
+/**
+ * ary_init_with_alloc() - initialize an array that uses its own allocator
+ * @ary: typed pointer to the array
+ * @hint: count of elements to allocate memory for
+ * @_allocator: pointer to the allocator, has to stay valid as long as @ary's
+ *	buffer isn't released
+ *
+ * Like ary_init(), but @ary's buffer is (re)allocated and released with
+ * @_allocator instead of ary_xrealloc() and the routine set by
+ * ary_use_as_free(). A buffer returned by ary_detach() has to be released with
+ * @_allocator as well. ary_release() reinitializes @ary with ary_init(), so the
+ * allocator has to be set again afterwards.
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed. Always returns
+ *	1 if @hint is 0.
+ */
+#define ary_init_with_alloc(ary, hint, _allocator)                \
+	((void)ary_init((ary), 0), (ary)->s.allocator = (_allocator), \
 	 ary_grow((ary), (hint)))
 
+/**
+ * ary_sbo_init() - initialize an array with inline storage
+ * @ary: typed pointer to the ary_sbo() array
+ * @hint: count of elements to allocate memory for
+ *
+ * Like ary_init(), but @ary uses its inline storage until it holds more
+ * elements than fit in there, only then memory is allocated. ary_shrinktofit()
+ * and ary_detach() move the elements back into the inline storage if they fit.
+ *
+ * Note!: @ary must not be copied or moved, as its buffer may point into itself.
+ *	ary_release() turns @ary into a regular array, use ary_sbo_release() to
+ *	keep using the inline storage.
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed. Always returns
+ *	1 if @hint doesn't exceed the inline storage.
+ */
+#define ary_sbo_init(ary, hint)                                          \
+	((void)ary_init((ary), 0),                                       \
+	 (ary)->s.inl = (ary)->s.buf = (ary)->buf = (ary)->inl,          \
+	 (ary)->s.ninl = (ary)->s.alloc = sizeof((ary)->inl) /           \
+	                                  sizeof((ary)->inl[0]),         \
+	 ary_grow((ary), (hint)))
+
+/**
+ * ary_sbo_release() - release an array with inline storage
+ * @ary: typed pointer to the initialized ary_sbo() array
+ *
+ * Like ary_release(), but @ary is reinitialized with `ary_sbo_init(@ary, 0)`.
+ */
+#define ary_sbo_release(ary)                  \
+	do {                                  \
+		ARY_TRACE_SAVE(ary);          \
+		ary_freebuf(&(ary)->s);       \
+		(void)ary_sbo_init((ary), 0); \
+		ARY_TRACE_RESTORE(ary);       \
+	} while (0)
+
+/* flags of ary_map() */
+#define ARY_MAP_CREATE 0x1 /* create the file if it doesn't exist */
+#define ARY_MAP_TRUNC 0x2  /* discard the file's elements */
+
+/**
+ * ary_map() - initialize an array that is stored in a file
+ * @ary: typed pointer to the array
+ * @path: path to the file
+ * @flags: bitwise or of ARY_MAP_* flags
+ *
+ * The file is mapped into memory and its elements are directly accessible, it
+ * grows and shrinks along with @ary. @ary is always initialized with
+ * `ary_init(@ary, 0)` first. The file has a header that records the element
+ * size and the length of @ary (in native byte order), so an array can only be
+ * mapped from a file written by an array of the same type. ary_release()
+ * stores the length, cuts off unused capacity and unmaps the file, afterwards
+ * @ary is a regular array again (the same applies to ary_shrinktofit() on an
+ * empty array).
+ *
+ * Note!: @ary must not be copied or moved, and its buffer must not be detached.
+ *
+ * Return: When successful 1, otherwise 0 if the file couldn't be opened or
+ *	mapped, or it doesn't contain elements of @ary's size.
+ */
+#define ary_map(ary, path, flags)                                        \
+	((void)ary_init((ary), 0),                                       \
+	 (ary_map)(&(ary)->s, (path), (flags)) ?                         \
+	 ((ary)->buf = (ary)->s.buf, (ary)->len = (ary)->s.len, 1) : 0)
+
+/**
+ * ary_sync() - flush an array mapped by ary_map() to its file
+ * @ary: typed pointer to the mapped array
+ *
+ * Return: When successful 1, otherwise 0 if @ary isn't mapped or msync()
+ *	failed.
+ */
+#define ary_sync(ary) \
+	((ary_sync)(&(ary)->s) ? ((ary)->buf = (ary)->s.buf, 1) : \
+	 ((ary)->buf = (ary)->s.buf, 0))
+
 /**
  * ary_release() - release an array
  * @ary: typed pointer to the initialized array
@@ -132,10 +611,58 @@ void ary_use_as_free(ary_xdealloc_t routine);
  */
 #define ary_release(ary)                  \
 	do {                              \
+		ARY_TRACE_SAVE(ary);      \
 		ary_freebuf(&(ary)->s);   \
 		(void)ary_init((ary), 0); \
+		ARY_TRACE_RESTORE(ary);   \
 	} while (0)
 
+/**
+ * ary_release_async() - release an array later
+ * @ary: typed pointer to the initialized array
+ *
+ * Like ary_release(), but the buffer together with the destructors and the
+ * user-pointer is only queued, so this doesn't depend on the array's length.
+ * The queue is drained by ary_reclaim_step() or by the thread started with
+ * ary_reclaim_start(), so the destructors and the allocator have to cope with
+ * being called from there. Inline storage and arrays mapped by ary_map() are
+ * released right away, as is everything if the queue entry can't be
+ * allocated.
+ */
+#define ary_release_async(ary)                  \
+	do {                                    \
+		ARY_TRACE_SAVE(ary);            \
+		(ary_release_async)(&(ary)->s); \
+		(void)ary_init((ary), 0);       \
+		ARY_TRACE_RESTORE(ary);         \
+	} while (0)
+
+/**
+ * ary_reclaim_step() - release queued arrays
+ * @budget: maximum number of elements to destruct, 0 for no limit
+ *
+ * Arrays are processed in the order they were queued by ary_release_async(),
+ * one that exceeds @budget is continued by the next call.
+ *
+ * Return: 1 if arrays are still queued, otherwise 0.
+ */
+int ary_reclaim_step(size_t budget);
+
+/**
+ * ary_reclaim_start() - start a thread that releases queued arrays
+ *
+ * Return: When successful or if the thread is already running 1, otherwise 0
+ *	if threads aren't supported or the thread couldn't be created.
+ */
+int ary_reclaim_start(void);
+
+/**
+ * ary_reclaim_stop() - stop the thread started by ary_reclaim_start()
+ *
+ * Waits for the thread and releases all arrays that are still queued.
+ */
+void ary_reclaim_stop(void);
+
 /**
  * ary_setcbs() - set an array's constructor and destructor
  * @ary: typed pointer to the initialized array
@@ -145,6 +672,19 @@ void ary_use_as_free(ary_xdealloc_t routine);
 #define ary_setcbs(ary, _ctor, _dtor) \
 	((ary)->s.ctor = (_ctor), (ary)->s.dtor = (_dtor), (void)0)
 
+/**
+ * ary_setrangecbs() - set an array's range constructor and destructor
+ * @ary: typed pointer to the initialized array
+ * @_rctor: routine that creates a range of new elements
+ * @_rdtor: routine that removes a range of elements
+ *
+ * Whenever multiple elements are created or removed at once, they're passed to
+ * these in a single call, single elements are passed as a range of one. Each
+ * is used instead of its counterpart from ary_setcbs() if not NULL.
+ */
+#define ary_setrangecbs(ary, _rctor, _rdtor) \
+	((ary)->s.rctor = (_rctor), (ary)->s.rdtor = (_rdtor), (void)0)
+
  /**
  * ary_setuserp() - set an array's user-pointer for the ctor/dtor
  * @ary: typed pointer to the initialized array
@@ -153,6 +693,76 @@ void ary_use_as_free(ary_xdealloc_t routine);
 #define ary_setuserp(ary, ptr) \
 	((ary)->s.userp = (ptr), (void)0)
 
+/**
+ * ary_setgrowth() - set an array's growth policy
+ * @ary: typed pointer to the initialized array
+ * @policy: one of the policies below
+ * @arg: parameter of @policy, 0 for its default
+ *
+ * Policies:
+ *	ARY_GROW_GEOMETRIC: multiply the capacity by @arg percent, e.g. 150 for
+ *		1.5x (default: ARY_GROWTH_PERCENT)
+ *	ARY_GROW_ROUNDED: double the capacity and round the buffer size up to
+ *		the next power of 2 if it's below @arg bytes, otherwise to the
+ *		next multiple of @arg bytes (default: 4096, i.e. allocator size
+ *		classes and pages)
+ *	ARY_GROW_CHUNKED: add as many chunks of @arg elements as needed
+ *		(default: 64)
+ *
+ * In any case, the capacity grows by at least as much as is requested.
+ */
+#define ary_setgrowth(ary, policy, arg) \
+	((ary)->s.growth = (policy), (ary)->s.growarg = (arg), (void)0)
+
+/**
+ * ary_setdeque() - enable/disable the deque-mode of an array
+ * @ary: typed pointer to the initialized array
+ * @on: whether to enable the deque-mode
+ *
+ * In deque-mode, ary_shift() doesn't move the remaining elements but just
+ * advances the start of the buffer, likewise ary_unshift() and ary_splice()
+ * near the beginning of the array use (and grow) the unused memory in front of
+ * the buffer. So adding/removing elements at both ends is amortized O(1), and
+ * @ary->buf is contiguous at any time. The unused memory in front of the buffer
+ * is reclaimed by ary_grow() and ary_shrinktofit().
+ */
+#define ary_setdeque(ary, on)                                       \
+	((ary)->s.flags = (on) ? (ary)->s.flags | ARY_DEQUE :       \
+	                         (ary)->s.flags & ~(unsigned)ARY_DEQUE, \
+	 (void)0)
+
+/**
+ * ary_sethashidx() - maintain a hash index for ary_index() lookups
+ * @ary: typed pointer to the initialized array
+ * @hash: hash function, e.g. ary_cb_hashbytes() or ary_cb_hashstr(), NULL to
+ *	drop the index
+ * @comp: comparison function the index is used for, if NULL then memcmp()
+ *
+ * Afterwards ary_index() calls with the same @comp take O(1) on average instead
+ * of scanning the array (and so does ary_indexall() per element found). Pushed
+ * elements are indexed at the next lookup, ary_pop(), ary_shift(),
+ * ary_setlen() and ary_splice() at the end of the array keep the index up to
+ * date, whereas everything else that reorders or replaces elements (e.g.
+ * ary_sort(), ary_insert() or ary_unshift()) causes a rebuild at the next
+ * lookup. Many duplicates of an element lengthen its probe sequence. The index
+ * is dropped by ary_release().
+ *
+ * Note!: Elements that are modified directly via @ary->buf aren't noticed, call
+ *	ary_hashidx_invalidate() after doing so.
+ *
+ * Return: When successful 1, otherwise 0 if realloc() failed (the index is
+ *	dropped in this case).
+ */
+#define ary_sethashidx(ary, hash, comp) \
+	(ary_sethashidx)(&(ary)->s, (hash), (comp))
+
+/**
+ * ary_hashidx_invalidate() - rebuild an array's hash index at the next lookup
+ * @ary: typed pointer to the initialized array
+ */
+#define ary_hashidx_invalidate(ary) \
+	((ary)->s.flags |= ARY_STALE, (void)0)
+
 /**
  * ary_setinitval() - set an array's value used to initialize new elements
  * @ary: typed pointer to the initialized array
@@ -181,6 +791,7 @@ void ary_use_as_free(ary_xdealloc_t routine);
 		(ary)->s.buf = (ary)->buf = nbuf; \
 		(ary)->s.len = (ary)->len = nlen; \
 		(ary)->s.alloc = nalloc;          \
+		(ary)->s.head = 0;                \
 	} while (0)
 
 /**
@@ -191,11 +802,14 @@ void ary_use_as_free(ary_xdealloc_t routine);
  * A directly following ary_release() is not needed.
  *
  * Return: The array buffer of @ary. If @ary's has no allocated memory, NULL is
- *	returned. You have to free() the buffer, when you no longer need it.
+ *	returned. You have to free() the buffer (or release it with @ary's
+ *	allocator, see ary_init_with_alloc()), when you no longer need it. The
+ *	elements of an array with inline storage are copied to a new buffer, if
+ *	that fails, NULL is returned and the array remains unchanged.
  */
-#define ary_detach(ary, size)                                             \
-	((ary)->ptr = (ary_detach)(&(ary)->s, (size)), (ary)->buf = NULL, \
-	 (ary)->len = 0, (ary)->ptr)
+#define ary_detach(ary, size)                                       \
+	((ary)->ptr = (ary_detach)(&(ary)->s, (size)),              \
+	 (ary)->buf = (ary)->s.buf, (ary)->len = (ary)->s.len, (ary)->ptr)
 
 /**
  * ary_grow() - allocate new memory in an array
@@ -246,17 +860,22 @@ void ary_use_as_free(ary_xdealloc_t routine);
 		if ((ary)->s.len < len) {                                      \
 			if ((ary)->s.alloc < len)                              \
 				len = (ary)->s.alloc;                          \
-			if ((ary)->s.ctor) {                                   \
-				for (i = (ary)->s.len; i < len; i++)           \
-					(ary)->s.ctor(&(ary)->buf[i],          \
-					              (ary)->s.userp);         \
+			if ((ary)->s.ctor || (ary)->s.rctor) {                 \
+				ary_construct(&(ary)->s,                       \
+				              &(ary)->buf[(ary)->s.len],       \
+				              len - (ary)->s.len);             \
 			} else {                                               \
 				for (i = (ary)->s.len; i < len; i++)           \
 					(ary)->buf[i] = (ary)->val;            \
 			}                                                      \
-		} else if ((ary)->s.len > len && (ary)->s.dtor) {              \
-			for (i = len; i < (ary)->s.len; i++)                   \
-				(ary)->s.dtor(&(ary)->buf[i], (ary)->s.userp); \
+		} else if ((ary)->s.len > len) {                               \
+			if ((ary)->s.hidx)                                     \
+				ary_hashidx_trunc(&(ary)->s, len);             \
+			if ((ary)->s.dtor || (ary)->s.rdtor)                   \
+				ary_destruct(&(ary)->s, &(ary)->buf[len],      \
+				             (ary)->s.len - len);              \
+			if ((ary)->s.allocator)                                \
+				(ary_trim)(&(ary)->s, len);                    \
 		}                                                              \
 		(ary)->s.len = (ary)->len = len;                               \
 	} while (0)
@@ -298,6 +917,80 @@ void ary_use_as_free(ary_xdealloc_t routine);
 	 &(ary)->buf[(ary)->len++, (ary)->s.len++] : NULL : \
 	 &(ary)->buf[(ary)->len++, (ary)->s.len++])
 
+/**
+ * ary_push_n_uninit() - add new element slots to the end of an array
+ * @ary: typed pointer to the initialized array
+ * @n: number of element slots to add (greater than 0)
+ *
+ * The new slots are left uninitialized, neither @ary->ctor() nor the init-
+ * value are used.
+ *
+ * Return: When successful a pointer to the first new element slot, otherwise
+ *	NULL if ary_grow() failed.
+ */
+#define ary_push_n_uninit(ary, n)                                          \
+	(((ary)->ptr = (ary_push_n_uninit)(&(ary)->s, (n))) ?              \
+	 ((ary)->buf = (ary)->s.buf, (ary)->len = (ary)->s.len, (ary)->ptr) : \
+	 NULL)
+
+/**
+ * ary_push_n() - create new elements at the end of an array
+ * @ary: typed pointer to the initialized array
+ * @n: number of elements to create
+ *
+ * The new elements are initialized like by ary_emplace().
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed.
+ */
+#define ary_push_n(ary, n)                                                 \
+	((ary_push_n)(&(ary)->s, (n), &(ary)->val) ?                       \
+	 ((ary)->buf = (ary)->s.buf, (ary)->len = (ary)->s.len, 1) : 0)
+
+/**
+ * ary_extend() - add multiple elements to the end of an array
+ * @ary: typed pointer to the initialized array
+ * @data: pointer to the elements to copy, may point into @ary itself
+ * @n: number of elements
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed.
+ */
+#define ary_extend(ary, data, n)                                           \
+	((ary_extend)(&(ary)->s, (data), (n)) ?                            \
+	 ((ary)->buf = (ary)->s.buf, (ary)->len = (ary)->s.len, 1) : 0)
+
+/**
+ * ary_extend_from() - add all elements of another array to the end of an array
+ * @ary: typed pointer to the initialized array
+ * @other: typed pointer to the initialized array to copy from, can be @ary
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed.
+ */
+#define ary_extend_from(ary, other) \
+	ary_extend((ary), (other)->buf, (other)->len)
+
+/**
+ * ary_gather() - add the elements of multiple arrays to the end of an array
+ * @dst: typed pointer to the initialized array
+ * @parts: C array of initialized arrays of the same type as @dst, e.g. the
+ *	per-thread arrays of some workers, @dst mustn't be one of them
+ * @n: number of arrays in @parts
+ * @nthreads: maximum number of threads to use (up to 64), 0 for the number of
+ *	online processors
+ *
+ * @dst is grown only once and the elements of all @parts are copied in order
+ * like by ary_extend(), in parallel if there's enough to copy (at least 1 MiB
+ * per thread). @parts are left as they are.
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed (@dst remains
+ *	unchanged in this case).
+ */
+#define ary_gather(dst, parts, n, nthreads)                                  \
+	((void)sizeof((dst)->buf == (parts)[0].buf),                         \
+	 (ary_gather)(&(dst)->s, &(parts)[0].s, sizeof((parts)[0]), (n),     \
+	              (nthreads)) ?                                          \
+	 ((dst)->buf = (dst)->s.buf, (dst)->len = (dst)->s.len, 1) :         \
+	 ((dst)->buf = (dst)->s.buf, 0))
+
 /**
  * ary_pop() - remove the last element of an array
  * @ary: typed pointer to the initialized array
@@ -309,35 +1002,36 @@ void ary_use_as_free(ary_xdealloc_t routine);
  */
 #define ary_pop(ary, ret)                                             \
 	((ary)->s.len ?                                               \
-	 ((void *)(ret) != NULL) ?                                    \
-	 (*(((void *)(ret) != NULL) ? (ret) : &(ary)->val) =          \
-	  (ary)->buf[--(ary)->s.len], (ary)->len--, 1) :              \
-	 (ary)->s.dtor ?                                              \
-	 ((ary)->s.dtor(&(ary)->buf[--(ary)->s.len], (ary)->s.userp), \
-	  (ary)->len--, 1) :                                          \
-	 ((ary)->s.len--, (ary)->len--, 1) : 0)
+	 ((ary)->s.hidx ?                                             \
+	  ary_hashidx_trunc(&(ary)->s, (ary)->s.len - 1) : (void)0,   \
+	  ((void *)(ret) != NULL) ?                                   \
+	  (*(((void *)(ret) != NULL) ? (ret) : &(ary)->val) =         \
+	   (ary)->buf[--(ary)->s.len], (ary)->len--, 1) :             \
+	  ((ary)->s.dtor || (ary)->s.rdtor) ?                         \
+	  (ary_destruct(&(ary)->s, &(ary)->buf[--(ary)->s.len], 1),   \
+	   (ary)->len--, 1) :                                         \
+	  ((ary)->s.len--, (ary)->len--, 1)) : 0)
 
 /**
  * ary_shift() - remove the first element of an array
  * @ary: typed pointer to the initialized array
  * @ret: pointer that receives the shifted element's value, can be NULL
  *
- * If @ret is NULL, @ary->dtor() is called for the element to be shifted.
+ * If @ret is NULL, @ary->dtor() is called for the element to be shifted. See
+ * ary_setdeque() to make this O(1).
  *
  * Return: When successful 1, otherwise 0 if there were no elements to shift.
  */
-#define ary_shift(ary, ret)                                                 \
-	((ary)->s.len ?                                                     \
-	 ((void *)(ret) != NULL) ?                                          \
-	 (*(((void *)(ret) != NULL) ? (ret) : &(ary)->val) = (ary)->buf[0], \
-	  memmove(&(ary)->buf[0], &(ary)->buf[1],                           \
-	          --(ary)->s.len * (ary)->s.sz), (ary)->len--, 1) :         \
-	 (ary)->s.dtor ?                                                    \
-	 ((ary)->s.dtor(&(ary)->buf[0], (ary)->s.userp),                    \
-	  memmove(&(ary)->buf[0], &(ary)->buf[1],                           \
-	          --(ary)->s.len * (ary)->s.sz), (ary)->len--, 1) :         \
-	 (memmove(&(ary)->buf[0], &(ary)->buf[1],                           \
-	          --(ary)->s.len * (ary)->s.sz), (ary)->len--, 1) : 0)
+#define ary_shift(ary, ret)                                               \
+	((ary)->s.len ?                                                   \
+	 (((void *)(ret) != NULL) ?                                       \
+	  (void)(*(((void *)(ret) != NULL) ? (ret) : &(ary)->val) =       \
+	         (ary)->buf[0]) :                                         \
+	  ((ary)->s.dtor || (ary)->s.rdtor) ?                             \
+	  ary_destruct(&(ary)->s, &(ary)->buf[0], 1) :                    \
+	  (void)0,                                                        \
+	  (ary_shift)(&(ary)->s), (ary)->buf = (ary)->s.buf,              \
+	  (ary)->len--, 1) : 0)
 
 /**
  * ary_unshift() - add a new element to the beginning of an array
@@ -346,7 +1040,7 @@ void ary_use_as_free(ary_xdealloc_t routine);
  *
  * Return: When successful 1, otherwise 0 if ary_grow() failed.
  *
- * Note!: @... is like in ary_push().
+ * Note!: @... is like in ary_push(). See ary_setdeque() to make this O(1).
  */
 #define ary_unshift(ary, ...) \
 	(ary_unshiftp(ary) ? (*(ary)->ptr = (__VA_ARGS__), 1) : 0)
@@ -425,22 +1119,418 @@ void ary_use_as_free(ary_xdealloc_t routine);
 	                                   (ary)->ptr, (comp)))
 
 /**
- * ary_reverse() - reverse an array
+ * ary_count() - count the occurrences of an element in an array
  * @ary: typed pointer to the initialized array
+ * @start: position to start looking from
+ * @data: pointer to the data to look for
+ * @comp: comparison function, if NULL then memcmp() is used
  *
- * Return: When successful 1, otherwise 0 if realloc() failed.
+ * Return: The number of elements from @start on that equal @data.
  */
+#define ary_count(ary, start, data, comp) \
+	((ary)->ptr = (data),             \
+	 (ary_count)(&(ary)->s, (start), (ary)->ptr, (comp)))
 
+/**
+ * ary_indexall() - get all occurrences of an element in an array
+ * @ary: typed pointer to the initialized array
+ * @ret: typed pointer to an initialized size_t array, the positions of the
+ *	elements found are appended to it in ascending order
+ * @start: position to start looking from
+ * @data: pointer to the data to look for
+ * @comp: comparison function, if NULL then memcmp() is used
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed (@ret holds the
+ *	positions found so far in this case).
+ */
+#define ary_indexall(ary, ret, start, data, comp)                           \
+	((void)sizeof((ret)->buf == (size_t *)0), (ary)->ptr = (data),      \
+	 (ary_indexall)(&(ary)->s, &(ret)->s, (start), (ary)->ptr, (comp)) ? \
+	 ((ret)->buf = (ret)->s.buf, (ret)->len = (ret)->s.len, 1) :         \
+	 ((ret)->buf = (ret)->s.buf, (ret)->len = (ret)->s.len, 0))
+
+/**
+ * ary_reverse() - reverse an array
+ * @ary: typed pointer to the initialized array
+ *
+ * Nothing is allocated, arrays of 1, 2, 4, 8 or 16 byte elements are reversed
+ * with SSE2 where available.
+ *
+ * Return: Always 1.
+ */
 #define ary_reverse(ary) \
 	(ary_reverse)(&(ary)->s)
 
+/**
+ * ary_rotate() - rotate an array
+ * @ary: typed pointer to the initialized array
+ * @n: number of elements to move from the beginning to the end, taken modulo
+ *	@ary's length
+ *
+ * Afterwards the element at position @n is the first one. To rotate the other
+ * way around, pass `@ary->len - @n`.
+ */
+#define ary_rotate(ary, n) \
+	(ary_rotate)(&(ary)->s, (n))
+
+/**
+ * ary_shuffle() - shuffle an array
+ * @ary: typed pointer to the initialized array
+ * @rnd: random number generator, if NULL then ary_cb_splitmix64() (its state
+ *	is a pointer to a uint64_t seed)
+ * @state: pointer passed to @rnd, if NULL then a global state is used (which
+ *	isn't thread-safe)
+ *
+ * Every permutation is about equally likely (Fisher-Yates).
+ */
+#define ary_shuffle(ary, rnd, state) \
+	(ary_shuffle)(&(ary)->s, (rnd), (state))
+
  /**
  * ary_sort() - sort all elements in an array
  * @ary: typed pointer to the initialized array
  * @comp: comparison function
  */
-#define ary_sort(ary, comp) \
-	qsort((ary)->s.buf, (ary)->s.len, (ary)->s.sz, (comp))
+#define ary_sort(ary, comp)                                      \
+	(qsort((ary)->s.buf, (ary)->s.len, (ary)->s.sz, (comp)), \
+	 ary_hashidx_invalidate(ary))
+
+/**
+ * ary_sort_parallel() - sort all elements in an array using multiple threads
+ * @ary: typed pointer to the initialized array
+ * @comp: comparison function
+ * @nthreads: maximum number of threads to use (up to 64), 0 for the number of
+ *	online processors
+ *
+ * Runs of the array are sorted in parallel and merged in parallel rounds. Each
+ * thread is given at least 32768 elements, arrays that are too short for two
+ * threads are sorted like ary_sort() would. The same applies if the temporary
+ * buffer for merging couldn't be allocated.
+ */
+#define ary_sort_parallel(ary, comp, nthreads) \
+	(ary_sort_parallel)(&(ary)->s, (comp), (nthreads))
+
+/**
+ * ary_sort_int() - sort all elements in an int-array
+ * @ary: typed pointer to the initialized array
+ *
+ * Like `ary_sort(@ary, ary_cb_cmpint)`, but the comparison is inlined (and
+ * large arrays are radix sorted). The same goes for ary_sort_long(),
+ * ary_sort_vlong(), ary_sort_size_t(), ary_sort_double() and ary_sort_char().
+ */
+#define ary_sort_int(ary) \
+	(ary_sortbuf_int((ary)->buf, (ary)->s.len), \
+	 ary_hashidx_invalidate(ary))
+#define ary_sort_long(ary) \
+	(ary_sortbuf_long((ary)->buf, (ary)->s.len), \
+	 ary_hashidx_invalidate(ary))
+#define ary_sort_vlong(ary) \
+	(ary_sortbuf_vlong((ary)->buf, (ary)->s.len), \
+	 ary_hashidx_invalidate(ary))
+#define ary_sort_size_t(ary) \
+	(ary_sortbuf_size_t((ary)->buf, (ary)->s.len), \
+	 ary_hashidx_invalidate(ary))
+#define ary_sort_double(ary) \
+	(ary_sortbuf_double((ary)->buf, (ary)->s.len), \
+	 ary_hashidx_invalidate(ary))
+#define ary_sort_char(ary) \
+	(ary_sortbuf_char((ary)->buf, (ary)->s.len), \
+	 ary_hashidx_invalidate(ary))
+
+/**
+ * ARY_SORT_DEFINE() - define a sort function for a specific type
+ * @scope: storage class of the function, e.g. `static` or nothing
+ * @name: name of the function
+ * @type: element type
+ * @lt: function-like macro taking two elements, true if the first is less
+ *	than the second, it may evaluate them more than once
+ *
+ * Defines `@scope void @name(@type *buf, size_t len)` which sorts @buf with an
+ * introsort (not stable) that has @lt inlined, e.g.:
+ *
+ *	#define POS_LT(a, b) ((a).x < (b).x || ((a).x == (b).x && (a).y < (b).y))
+ *	ARY_SORT_DEFINE(static, sort_pos, struct Pos, POS_LT)
+ *	...
+ *	sort_pos(a.buf, a.len);
+ */
+#define ARY_SORT_DEFINE(scope, name, type, lt)                                 \
+	static void name##_sift(type *buf, size_t i, size_t n)                 \
+	{                                                                      \
+		type tmp = buf[i];                                             \
+		size_t child;                                                  \
+                                                                               \
+		while ((child = 2 * i + 1) < n) {                              \
+			if (child + 1 < n && lt(buf[child], buf[child + 1]))   \
+				child++;                                       \
+			if (!lt(tmp, buf[child]))                              \
+				break;                                         \
+			buf[i] = buf[child];                                   \
+			i = child;                                             \
+		}                                                              \
+		buf[i] = tmp;                                                  \
+	}                                                                      \
+                                                                               \
+	static void name##_intro(type *buf, size_t n, unsigned depth)          \
+	{                                                                      \
+		type tmp;                                                      \
+		size_t i, j, m;                                                \
+                                                                               \
+		while (n > 16) {                                               \
+			if (!depth--) {                                        \
+				for (i = n / 2; i--;)                          \
+					name##_sift(buf, i, n);                \
+				for (i = n; --i;) {                            \
+					tmp = buf[0];                          \
+					buf[0] = buf[i];                       \
+					buf[i] = tmp;                          \
+					name##_sift(buf, 0, i);                \
+				}                                              \
+				return;                                        \
+			}                                                      \
+			/* move the median of three to the front */            \
+			i = 1;                                                 \
+			j = n / 2;                                             \
+			m = n - 1;                                             \
+			if (lt(buf[i], buf[j]))                                \
+				m = lt(buf[j], buf[m]) ? j :                   \
+				    lt(buf[i], buf[m]) ? m : i;                \
+			else                                                   \
+				m = lt(buf[i], buf[m]) ? i :                   \
+				    lt(buf[j], buf[m]) ? m : j;                \
+			tmp = buf[0];                                          \
+			buf[0] = buf[m];                                       \
+			buf[m] = tmp;                                          \
+			/* partition around it, the median guards both ends */ \
+			for (i = 1, j = n;; i++) {                             \
+				while (lt(buf[i], buf[0]))                     \
+					i++;                                   \
+				do                                             \
+					j--;                                   \
+				while (lt(buf[0], buf[j]));                    \
+				if (i >= j)                                    \
+					break;                                 \
+				tmp = buf[i];                                  \
+				buf[i] = buf[j];                               \
+				buf[j] = tmp;                                  \
+			}                                                      \
+			/* recurse into the smaller part */                    \
+			if (i < n - i) {                                       \
+				name##_intro(buf, i, depth);                   \
+				buf += i;                                      \
+				n -= i;                                        \
+			} else {                                               \
+				name##_intro(buf + i, n - i, depth);           \
+				n = i;                                         \
+			}                                                      \
+		}                                                              \
+		for (i = 1; i < n; i++) {                                      \
+			tmp = buf[i];                                          \
+			for (j = i; j && lt(tmp, buf[j - 1]); j--)             \
+				buf[j] = buf[j - 1];                           \
+			buf[j] = tmp;                                          \
+		}                                                              \
+	}                                                                      \
+                                                                               \
+	scope void name(type *buf, size_t len)                                 \
+	{                                                                      \
+		unsigned depth = 0;                                            \
+		size_t n;                                                      \
+                                                                               \
+		for (n = len; n > 1; n /= 2)                                   \
+			depth += 2;                                            \
+		name##_intro(buf, len, depth);                                 \
+	}
+
+/**
+ * ary_argsort() - get the positions of an array's elements in sorted order
+ * @ary: typed pointer to the initialized array
+ * @ret: typed pointer to an uninitialized size_t array
+ * @comp: comparison function
+ *
+ * @ary is left as it is, `@ret->buf[0]` is the position of its smallest
+ * element and so on. The sort is stable. @ret is always initialized with
+ * `ary_init(@ret, 0)`.
+ *
+ * Return: When successful 1, otherwise 0 if realloc() failed.
+ */
+#define ary_argsort(ary, ret, comp)                                          \
+	((void)sizeof((ret)->buf == (size_t *)0), (void)ary_init((ret), 0),  \
+	 (ary_argsort)(&(ary)->s, &(ret)->s, (comp)) ?                       \
+	 ((ret)->buf = (ret)->s.buf, (ret)->len = (ret)->s.len, 1) :         \
+	 ((ret)->buf = (ret)->s.buf, 0))
+
+/* helpers of ARY_SOA_DEFINE(), up to 16 columns */
+#define ARY_CAT(a, b) ARY_CAT_(a, b)
+#define ARY_CAT_(a, b) a##b
+#define ARY_NARGS(...) \
+	ARY_NARGS_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, \
+	           3, 2, 1, ~)
+#define ARY_NARGS_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, \
+                   _14, _15, _16, n, ...) n
+#define ARY_FOREACH(m, a, ...) \
+	ARY_CAT(ARY_FOREACH_, ARY_NARGS(__VA_ARGS__))(m, a, __VA_ARGS__)
+#define ARY_FOREACH_1(m, a, x) m(a, x)
+#define ARY_FOREACH_2(m, a, x, ...) m(a, x) ARY_FOREACH_1(m, a, __VA_ARGS__)
+#define ARY_FOREACH_3(m, a, x, ...) m(a, x) ARY_FOREACH_2(m, a, __VA_ARGS__)
+#define ARY_FOREACH_4(m, a, x, ...) m(a, x) ARY_FOREACH_3(m, a, __VA_ARGS__)
+#define ARY_FOREACH_5(m, a, x, ...) m(a, x) ARY_FOREACH_4(m, a, __VA_ARGS__)
+#define ARY_FOREACH_6(m, a, x, ...) m(a, x) ARY_FOREACH_5(m, a, __VA_ARGS__)
+#define ARY_FOREACH_7(m, a, x, ...) m(a, x) ARY_FOREACH_6(m, a, __VA_ARGS__)
+#define ARY_FOREACH_8(m, a, x, ...) m(a, x) ARY_FOREACH_7(m, a, __VA_ARGS__)
+#define ARY_FOREACH_9(m, a, x, ...) m(a, x) ARY_FOREACH_8(m, a, __VA_ARGS__)
+#define ARY_FOREACH_10(m, a, x, ...) m(a, x) ARY_FOREACH_9(m, a, __VA_ARGS__)
+#define ARY_FOREACH_11(m, a, x, ...) m(a, x) ARY_FOREACH_10(m, a, __VA_ARGS__)
+#define ARY_FOREACH_12(m, a, x, ...) m(a, x) ARY_FOREACH_11(m, a, __VA_ARGS__)
+#define ARY_FOREACH_13(m, a, x, ...) m(a, x) ARY_FOREACH_12(m, a, __VA_ARGS__)
+#define ARY_FOREACH_14(m, a, x, ...) m(a, x) ARY_FOREACH_13(m, a, __VA_ARGS__)
+#define ARY_FOREACH_15(m, a, x, ...) m(a, x) ARY_FOREACH_14(m, a, __VA_ARGS__)
+#define ARY_FOREACH_16(m, a, x, ...) m(a, x) ARY_FOREACH_15(m, a, __VA_ARGS__)
+
+/* a column is `(type, field)` */
+#define ARY_SOA_TYPE(type, field) type
+#define ARY_SOA_FIELD(type, field) field
+#define ARY_SOA_COL(soa, col) struct ary(ARY_SOA_TYPE col) ARY_SOA_FIELD col;
+#define ARY_SOA_PARAM(soa, col) , ARY_SOA_TYPE col ARY_SOA_FIELD col
+#define ARY_SOA_BASE(soa, col) &(soa)->ARY_SOA_FIELD col.s,
+#define ARY_SOA_INIT(soa, col) (void)ary_init(&(soa)->ARY_SOA_FIELD col, 0);
+#define ARY_SOA_RELEASE(soa, col) ary_release(&(soa)->ARY_SOA_FIELD col);
+#define ARY_SOA_GROW(soa, col) \
+	ret &= ary_grow(&(soa)->ARY_SOA_FIELD col, extra);
+#define ARY_SOA_SYNC(soa, col)                                         \
+	(soa)->ARY_SOA_FIELD col.buf = (soa)->ARY_SOA_FIELD col.s.buf; \
+	(soa)->ARY_SOA_FIELD col.len = (soa)->ARY_SOA_FIELD col.s.len; \
+	if ((soa)->ARY_SOA_FIELD col.s.alloc < (soa)->alloc)           \
+		(soa)->alloc = (soa)->ARY_SOA_FIELD col.s.alloc;
+#define ARY_SOA_STORE(soa, col)                                        \
+	(soa)->ARY_SOA_FIELD col.buf[(soa)->len] = ARY_SOA_FIELD col;  \
+	(soa)->ARY_SOA_FIELD col.s.len = (soa)->ARY_SOA_FIELD col.len = \
+		(soa)->len + 1;
+#define ARY_SOA_POP(soa, col) (void)ary_pop(&(soa)->ARY_SOA_FIELD col, NULL);
+#define ARY_SOA_SPLICE(soa, col) \
+	(void)ary_splicep(&(soa)->ARY_SOA_FIELD col, pos, rlen, alen);
+
+/**
+ * ARY_SOA_DEFINE() - define a structure of arrays
+ * @scope: storage class of the functions, e.g. `static inline` (no warnings
+ *	about unused ones) or nothing
+ * @name: name of the struct
+ * @...: up to 16 columns `(type, field)`
+ *
+ * Defines `struct @name` that holds an array `struct ary(type) field` per
+ * column, all of the same length `len`. So scanning a single column reads only
+ * its own elements instead of whole records, e.g.:
+ *
+ *	ARY_SOA_DEFINE(static inline, recs, (int, id), (double, score))
+ *	...
+ *	struct recs r;
+ *
+ *	recs_init(&r);
+ *	recs_push(&r, 1, 0.5);
+ *	recs_sort(&r, &r.score.s, ary_cb_cmpdouble);
+ *	for (i = 0; i < r.len; i++)
+ *		sum += r.score.buf[i];
+ *	recs_release(&r);
+ *
+ * The columns are regular arrays, functions that don't change them (e.g.
+ * ary_index()) or their elements can be used on them directly. Rows are added
+ * and removed with these functions:
+ *
+ *	void @name_init(struct @name *soa);
+ *	void @name_release(struct @name *soa);
+ *	int @name_grow(struct @name *soa, size_t extra);
+ *	int @name_push(struct @name *soa, type field, ...);
+ *	int @name_pop(struct @name *soa);
+ *	int @name_splicep(struct @name *soa, size_t pos, size_t rlen,
+ *	                  size_t alen);
+ *	int @name_sort(struct @name *soa, const struct aryb *key,
+ *	               ary_cmpcb_t comp);
+ *
+ * They work like their ary_*() counterparts on all columns at once: growing
+ * reallocates all columns together, so a row is either added to all of them or
+ * to none. @name_splicep() leaves the new rows uninitialized. @name_sort()
+ * sorts the rows (stable) by the column @key (`&soa->field.s`) and permutes
+ * all columns accordingly.
+ */
+#define ARY_SOA_DEFINE(scope, name, ...)                                       \
+	struct name {                                                          \
+		size_t len;   /* number of rows */                             \
+		size_t alloc; /* number of rows all columns can hold */        \
+		ARY_FOREACH(ARY_SOA_COL, ~, __VA_ARGS__)                       \
+	};                                                                     \
+                                                                               \
+	static inline void name##_sync(struct name *soa)                       \
+	{                                                                      \
+		soa->alloc = SIZE_MAX;                                         \
+		ARY_FOREACH(ARY_SOA_SYNC, soa, __VA_ARGS__)                    \
+	}                                                                      \
+                                                                               \
+	scope void name##_init(struct name *soa)                               \
+	{                                                                      \
+		ARY_FOREACH(ARY_SOA_INIT, soa, __VA_ARGS__)                    \
+		soa->len = soa->alloc = 0;                                     \
+	}                                                                      \
+                                                                               \
+	scope void name##_release(struct name *soa)                            \
+	{                                                                      \
+		ARY_FOREACH(ARY_SOA_RELEASE, soa, __VA_ARGS__)                 \
+		soa->len = soa->alloc = 0;                                     \
+	}                                                                      \
+                                                                               \
+	scope int name##_grow(struct name *soa, size_t extra)                  \
+	{                                                                      \
+		int ret = 1;                                                   \
+                                                                               \
+		if (extra <= soa->alloc - soa->len)                            \
+			return 1;                                              \
+		ARY_FOREACH(ARY_SOA_GROW, soa, __VA_ARGS__)                    \
+		name##_sync(soa);                                              \
+		return ret;                                                    \
+	}                                                                      \
+                                                                               \
+	scope int name##_push(struct name *soa                                 \
+	                      ARY_FOREACH(ARY_SOA_PARAM, ~, __VA_ARGS__))      \
+	{                                                                      \
+		if (soa->len == soa->alloc && !name##_grow(soa, 1))            \
+			return 0;                                              \
+		ARY_FOREACH(ARY_SOA_STORE, soa, __VA_ARGS__)                   \
+		soa->len++;                                                    \
+		return 1;                                                      \
+	}                                                                      \
+                                                                               \
+	scope int name##_pop(struct name *soa)                                 \
+	{                                                                      \
+		if (!soa->len)                                                 \
+			return 0;                                              \
+		ARY_FOREACH(ARY_SOA_POP, soa, __VA_ARGS__)                     \
+		soa->len--;                                                    \
+		return 1;                                                      \
+	}                                                                      \
+                                                                               \
+	scope int name##_splicep(struct name *soa, size_t pos, size_t rlen,    \
+	                         size_t alen)                                  \
+	{                                                                      \
+		if (pos > soa->len)                                            \
+			pos = soa->len;                                        \
+		if (rlen > soa->len - pos)                                     \
+			rlen = soa->len - pos;                                 \
+		if (alen > rlen && !name##_grow(soa, alen - rlen))             \
+			return 0;                                              \
+		ARY_FOREACH(ARY_SOA_SPLICE, soa, __VA_ARGS__)                  \
+		soa->len = soa->len - rlen + alen;                             \
+		name##_sync(soa);                                              \
+		return 1;                                                      \
+	}                                                                      \
+                                                                               \
+	scope int name##_sort(struct name *soa, const struct aryb *key,        \
+	                      ary_cmpcb_t comp)                                \
+	{                                                                      \
+		struct aryb *cols[] = {                                        \
+			ARY_FOREACH(ARY_SOA_BASE, soa, __VA_ARGS__)            \
+		};                                                             \
+                                                                               \
+		return ary_soa_sort(cols, sizeof(cols) / sizeof(cols[0]), key, \
+		                    comp);                                     \
+	}
 
 /**
  * ary_join() - join all elements of an array into a string
@@ -456,6 +1546,26 @@ void ary_use_as_free(ary_xdealloc_t routine);
 #define ary_join(ary, ret, sep, stringify) \
 	(ary_join)(&(ary)->s, (ret), (sep), (stringify))
 
+/**
+ * ary_join_append() - join all elements of an array onto a char-array
+ * @ary: typed pointer to the initialized array
+ * @out: pointer to the initialized char-array to append to
+ * @sep: pointer to the null-terminated separator
+ * @append: append function that writes straight into @out, if NULL then @ary
+ *	is assumed to be a char *-array
+ * @hint: expected length of a single element's string, @out is grown to fit
+ *	all of them up front (0 means grow on demand)
+ *
+ * @out's buffer is null-terminated after the appended string, the terminator
+ * isn't counted in its length. Unlike ary_join() nothing is allocated per
+ * element, and @out can be reused to join without allocating at all.
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed (@out keeps its
+ *	original length in this case).
+ */
+#define ary_join_append(ary, out, sep, append, hint) \
+	(ary_join_append)(&(ary)->s, (out), (sep), (append), (hint))
+
 /**
  * ary_slice() - select a part of an array into a new one
  * @ary: typed pointer to the initialized array
@@ -535,8 +1645,9 @@ void ary_use_as_free(ary_xdealloc_t routine);
  */
 #define ary_emplace(ary, pos)                                         \
 	(ary_insertp((ary), (pos)) ?                                  \
-	 ((ary)->s.ctor ? (ary)->s.ctor((ary)->ptr, (ary)->s.userp) : \
-	                  (void)(*(ary)->ptr = (ary)->val), 1) : 0)
+	 (((ary)->s.ctor || (ary)->s.rctor) ?                         \
+	  ary_construct(&(ary)->s, (ary)->ptr, 1) :                   \
+	  (void)(*(ary)->ptr = (ary)->val), 1) : 0)
 
 /**
  * ary_snatch() - remove an element of an array without calling the destructor
@@ -553,13 +1664,15 @@ void ary_use_as_free(ary_xdealloc_t routine);
 	                           (pos) : (ary)->s.len - 1],             \
 	  *(((void *)(ret) != NULL) ? (ret) : &(ary)->val) = *(ary)->ptr, \
 	  memmove((ary)->ptr, (ary)->ptr + 1,                             \
-	          &(ary)->buf[--(ary)->s.len] - (ary)->ptr),              \
-	  (ary)->len--, 1) :                                              \
+	          (&(ary)->buf[--(ary)->s.len] - (ary)->ptr) *            \
+	          (ary)->s.sz),                                           \
+	  ary_hashidx_invalidate(ary), (ary)->len--, 1) :                 \
 	 ((ary)->ptr = &(ary)->buf[((pos) < (ary)->s.len) ?               \
 	                           (pos) : (ary)->s.len - 1],             \
 	  memmove((ary)->ptr, (ary)->ptr + 1,                             \
-	          &(ary)->buf[--(ary)->s.len] - (ary)->ptr),              \
-	  (ary)->len--, 1) : 0)                                           \
+	          (&(ary)->buf[--(ary)->s.len] - (ary)->ptr) *            \
+	          (ary)->s.sz),                                           \
+	  ary_hashidx_invalidate(ary), (ary)->len--, 1) : 0)
 
 /**
  * ary_swap() - swap two elements in an array
@@ -567,7 +1680,7 @@ void ary_use_as_free(ary_xdealloc_t routine);
  * @a: position of the first element
  * @b: position of the second element
  *
- * Return: When successful 1, otherwise 0 if realloc() failed.
+ * Return: Always 1.
  */
 #define ary_swap(ary, a, b) \
 	(ary_swap)(&(ary)->s, (a), (b))
@@ -580,40 +1693,394 @@ void ary_use_as_free(ary_xdealloc_t routine);
  * @data: pointer to the data to search for
  * @comp: comparison function
  *
- * Return: When successful 1 and @ret is set to the position of the element
- *	found, otherwise 0 and @ret is uninitialized.
+ * Return: When successful 1 and @ret is set to the position of the first
+ *	equal element, otherwise 0 and @ret is uninitialized.
  */
 #define ary_search(ary, ret, start, data, comp)                       \
 	((ary)->ptr = (data), (ary_search)(&(ary)->s, (ret), (start), \
 	                                   (ary)->ptr, (comp)))
 
+/**
+ * ary_lower_bound() - get the first position of an element in a sorted array
+ * @ary: typed pointer to the sorted array
+ * @data: pointer to the data to search for
+ * @comp: comparison function
+ *
+ * Return: The position of the first element that isn't less than @data, i.e.
+ *	where @data would be inserted before any equal elements (@ary->len if all
+ *	elements are less).
+ */
+#define ary_lower_bound(ary, data, comp) \
+	((ary)->ptr = (data), (ary_lower_bound)(&(ary)->s, (ary)->ptr, (comp)))
+
+/**
+ * ary_upper_bound() - get the position after an element in a sorted array
+ * @ary: typed pointer to the sorted array
+ * @data: pointer to the data to search for
+ * @comp: comparison function
+ *
+ * Return: The position of the first element that is greater than @data, i.e.
+ *	where @data would be inserted after any equal elements (@ary->len if no
+ *	element is greater).
+ */
+#define ary_upper_bound(ary, data, comp) \
+	((ary)->ptr = (data), (ary_upper_bound)(&(ary)->s, (ary)->ptr, (comp)))
+
+/**
+ * ary_equal_range() - get all positions of an element in a sorted array
+ * @ary: typed pointer to the sorted array
+ * @lo: pointer that receives ary_lower_bound(), can be NULL
+ * @hi: pointer that receives ary_upper_bound(), can be NULL
+ * @data: pointer to the data to search for
+ * @comp: comparison function
+ *
+ * Return: The number of elements equal to @data.
+ */
+#define ary_equal_range(ary, lo, hi, data, comp)                            \
+	((ary)->ptr = (data), (ary_equal_range)(&(ary)->s, (lo), (hi),      \
+	                                        (ary)->ptr, (comp)))
+
+/**
+ * ary_insert_sorted() - add a new element to a sorted array
+ * @ary: typed pointer to the sorted array
+ * @data: pointer to the element to insert (after any equal elements)
+ * @comp: comparison function
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed.
+ */
+#define ary_insert_sorted(ary, data, comp)                                 \
+	((ary)->ptr = (data),                                              \
+	 (ary_insert_sorted)(&(ary)->s, (ary)->ptr, (comp)) ?              \
+	 ((ary)->buf = (ary)->s.buf, (ary)->len = (ary)->s.len, 1) : 0)
+
+/**
+ * ary_merge_sorted() - merge two sorted arrays into a new one
+ * @a: typed pointer to the first sorted array
+ * @b: typed pointer to the second sorted array of the same type
+ * @ret: typed pointer to an unitialized array
+ * @comp: comparison function
+ *
+ * @ret will contain a shallow copy of all elements in O(@a->len + @b->len),
+ * equal elements of @a come before those of @b. @ret is always initialized
+ * with `ary_init(@ret, 0)` and @a's init-value is copied.
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed.
+ */
+#define ary_merge_sorted(a, b, ret, comp)                                    \
+	((void)sizeof((a)->buf == (b)->buf), (void)ary_init((ret), 0),      \
+	 (ary_merge_sorted)(&(a)->s, &(b)->s, &(ret)->s, (comp)) ?           \
+	 ((ret)->buf = (ret)->s.buf, (ret)->len = (ret)->s.len,              \
+	  (ret)->val = (a)->val, 1) : ((ret)->buf = (ret)->s.buf, 0))
+
+/* common part of the ary_set_*() macros */
+#define ary_setop(op, a, b, ret, comp)                                       \
+	((void)sizeof((a)->buf == (b)->buf), (void)ary_init((ret), 0),      \
+	 (op)(&(a)->s, &(b)->s, &(ret)->s, (comp)) ?                         \
+	 ((ret)->buf = (ret)->s.buf, (ret)->len = (ret)->s.len,              \
+	  (ret)->val = (a)->val, 1) : ((ret)->buf = (ret)->s.buf, 0))
+
+/**
+ * ary_set_union() - get the union of two sorted arrays
+ * @a: typed pointer to the first sorted array
+ * @b: typed pointer to the second sorted array of the same type, mixing types
+ *	is rejected at compile time
+ * @ret: typed pointer to an unitialized array
+ * @comp: comparison function
+ *
+ * @ret will contain a shallow copy of all elements that are in @a or @b,
+ * sorted. An element that occurs in both arrays is taken from @a, elements
+ * that occur multiple times are kept as often as they occur in either array.
+ * Intersections of strictly increasing int- and long long-arrays are
+ * vectorized if @comp is ary_cb_cmpint() or ary_cb_cmpvlong() respectively,
+ * and all ary_set_*() functions skip through a much larger array by
+ * exponential search. @ret is always initialized with `ary_init(@ret, 0)` and
+ * @a's init-value is copied.
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed.
+ */
+#define ary_set_union(a, b, ret, comp) \
+	ary_setop((ary_set_union), (a), (b), (ret), (comp))
+
+/**
+ * ary_set_intersect() - get the intersection of two sorted arrays
+ * @a: typed pointer to the first sorted array
+ * @b: typed pointer to the second sorted array of the same type, mixing types
+ *	is rejected at compile time
+ * @ret: typed pointer to an unitialized array
+ * @comp: comparison function
+ *
+ * Like ary_set_union(), but @ret only contains the elements of @a that are
+ * also in @b.
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed.
+ */
+#define ary_set_intersect(a, b, ret, comp) \
+	ary_setop((ary_set_intersect), (a), (b), (ret), (comp))
+
+/**
+ * ary_set_difference() - get the difference of two sorted arrays
+ * @a: typed pointer to the first sorted array
+ * @b: typed pointer to the second sorted array of the same type, mixing types
+ *	is rejected at compile time
+ * @ret: typed pointer to an unitialized array
+ * @comp: comparison function
+ *
+ * Like ary_set_union(), but @ret only contains the elements of @a that are
+ * not in @b.
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed.
+ */
+#define ary_set_difference(a, b, ret, comp) \
+	ary_setop((ary_set_difference), (a), (b), (ret), (comp))
+
+/**
+ * ary_set_symdiff() - get the symmetric difference of two sorted arrays
+ * @a: typed pointer to the first sorted array
+ * @b: typed pointer to the second sorted array of the same type, mixing types
+ *	is rejected at compile time
+ * @ret: typed pointer to an unitialized array
+ * @comp: comparison function
+ *
+ * Like ary_set_union(), but @ret only contains the elements that are in
+ * either @a or @b, but not in both.
+ *
+ * Return: When successful 1, otherwise 0 if ary_grow() failed.
+ */
+#define ary_set_symdiff(a, b, ret, comp) \
+	ary_setop((ary_set_symdiff), (a), (b), (ret), (comp))
+
 /**
  * ary_unique() - remove duplicates in an array
  * @ary: typed pointer to the array
  * @comp: comparison function
  *
- * Return: When successful 1, otherwise 0 if realloc() failed.
+ * The first occurrence of every element is kept and the order of the remaining
+ * elements is preserved, @ary->dtor() is called for the removed duplicates.
+ *
+ * Return: When successful 1, otherwise 0 if realloc() failed (the array remains
+ *	unchanged in this case).
  */
 #define ary_unique(ary, comp) \
 	((ary_unique)(&(ary)->s, (comp)) ? ((ary)->len = (ary)->s.len, 1) : 0)
 
+/**
+ * ary_unique_sorted() - remove duplicates in a sorted array
+ * @ary: typed pointer to the sorted array
+ * @comp: comparison function
+ *
+ * Like ary_unique(), but in-place and in linear time, as duplicates of a sorted
+ * array are adjacent to each other.
+ */
+#define ary_unique_sorted(ary, comp) \
+	((ary_unique_sorted)(&(ary)->s, (comp)), (ary)->len = (ary)->s.len, \
+	 (void)0)
+
+/**
+ * ary_conc_init() - initialize a concurrent array
+ * @c: typed pointer to the ary_conc() array
+ *
+ * A concurrent array only supports adding elements to its end, but any number
+ * of threads can do so at the same time without locking: ary_conc_pushp()
+ * reserves a slot with an atomic increment of the length. The elements are
+ * stored in segments that double in size and never move, so a pointer to an
+ * element stays valid while other threads keep adding. Once all threads are
+ * done, ary_conc_freeze() turns it into a regular array.
+ *
+ * Note!: ary_conc_pushp(), ary_conc_push(), ary_conc_at() and ary_conc_len()
+ *	are safe to call concurrently, everything else isn't. Elements aren't
+ *	constructed or destructed.
+ */
+#define ary_conc_init(c) \
+	(ary_conc_init)(&(c)->s, sizeof(*(c)->ptr))
+
+/**
+ * ary_conc_pushp() - add a new element slot to the end of a concurrent array
+ * @c: typed pointer to the initialized concurrent array
+ *
+ * Return: When successful a pointer to the new element slot, otherwise NULL if
+ *	the memory for it couldn't be allocated. Such a failure is permanent,
+ *	ary_conc_freeze() fails afterwards as well.
+ */
+#define ary_conc_pushp(c) \
+	(ary_conc_pushp)(&(c)->s)
+
+/**
+ * ary_conc_push() - add a new element to the end of a concurrent array
+ * @c: typed pointer to the initialized concurrent array
+ * @data: pointer to the element to copy
+ *
+ * Return: When successful 1, otherwise 0 (see ary_conc_pushp()).
+ */
+#define ary_conc_push(c, data) \
+	((void)sizeof((c)->ptr == (data)), (ary_conc_push)(&(c)->s, (data)))
+
+/**
+ * ary_conc_at() - get an element of a concurrent array
+ * @c: typed pointer to the initialized concurrent array
+ * @pos: position of the element
+ *
+ * The element has to be completely added, i.e. the thread that pushed it has to
+ * be synchronized with the caller.
+ *
+ * Return: A pointer to the element, NULL if @pos isn't reserved yet or its
+ *	segment is still being allocated by another thread or couldn't be
+ *	allocated.
+ */
+#define ary_conc_at(c, pos) \
+	(ary_conc_at)(&(c)->s, (pos))
+
+/**
+ * ary_conc_len() - get the length of a concurrent array
+ * @c: typed pointer to the initialized concurrent array
+ *
+ * Return: The number of element slots reserved so far, which might not all be
+ *	written yet.
+ */
+#define ary_conc_len(c) \
+	(ary_conc_len)(&(c)->s)
+
+/**
+ * ary_conc_release() - release a concurrent array
+ * @c: typed pointer to the initialized concurrent array
+ *
+ * All elements are removed and the memory is released, @c stays initialized.
+ */
+#define ary_conc_release(c) \
+	(ary_conc_release)(&(c)->s)
+
+/**
+ * ary_conc_freeze() - move the elements of a concurrent array to an array
+ * @c: typed pointer to the initialized concurrent array
+ * @ret: typed pointer to an uninitialized array of the same type
+ *
+ * @ret is always initialized with `ary_init(@ret, 0)`, afterwards it holds the
+ * elements in the order their slots were reserved, and @c is empty again. No
+ * thread may add elements to @c meanwhile.
+ *
+ * Return: When successful 1, otherwise 0 if a push failed or ary_grow() failed
+ *	(@c remains unchanged in this case).
+ */
+#define ary_conc_freeze(c, ret)                                            \
+	((void)sizeof((c)->ptr == (ret)->buf), (void)ary_init((ret), 0),    \
+	 (ary_conc_freeze)(&(c)->s, &(ret)->s) ?                           \
+	 ((ret)->buf = (ret)->s.buf, (ret)->len = (ret)->s.len, 1) : 0)
+
+/* (re)allocate memory with an array's allocator, a pointer to the inline
+ * storage is reallocated to a new buffer */
+static inline void *ary_allocbuf(struct aryb *ary, void *ptr, size_t nmemb)
+{
+	void *inl = NULL, *buf;
+
+	if (ptr && ptr == ary->inl) {
+		inl = ptr;
+		ptr = NULL;
+	}
+	if (ary->allocator)
+		buf = ary->allocator->realloc(ptr, nmemb, ary->sz,
+		                              ary->allocator->ctx);
+	else
+		buf = ary_xrealloc(ptr, nmemb, ary->sz);
+	if (inl && buf)
+		memcpy(buf, inl,
+		       ((nmemb < ary->ninl) ? nmemb : ary->ninl) * ary->sz);
+	return buf;
+}
+
+/* construct `n` elements at `ptr`, one of the constructors has to be set */
+static inline void ary_construct(struct aryb *ary, void *ptr, size_t n)
+{
+	char *elem = ptr;
+
+	ARY_STATS_COUNT(ary, ctors, n);
+	if (ary->rctor) {
+		ary->rctor(ptr, n, ary->userp);
+		return;
+	}
+	for (; n--; elem += ary->sz)
+		ary->ctor(elem, ary->userp);
+}
+
+/* destruct `n` elements at `ptr`, one of the destructors has to be set */
+static inline void ary_destruct(struct aryb *ary, void *ptr, size_t n)
+{
+	char *elem = ptr;
+
+	ARY_STATS_COUNT(ary, dtors, n);
+	if (ary->rdtor) {
+		ary->rdtor(ptr, n, ary->userp);
+		return;
+	}
+	for (; n--; elem += ary->sz)
+		ary->dtor(elem, ary->userp);
+}
+
+/* get the capacity an array grows to when it has to hold `need` elements */
+static inline size_t ary_nextalloc(const struct aryb *ary, size_t need)
+{
+	size_t alloc = ary->alloc, arg = ary->growarg, bytes, round;
+
+	switch (ary->growth) {
+	case ARY_GROW_ROUNDED:
+		if (!arg)
+			arg = 4096;
+		alloc = (alloc < need / 2) ? need : alloc * 2;
+		if (alloc > (SIZE_MAX - arg) / ary->sz)
+			return need;
+		bytes = alloc * ary->sz;
+		if (bytes < arg) {
+			for (round = 16; round < bytes; round *= 2)
+				;
+			bytes = round;
+		} else {
+			bytes += arg - 1;
+			bytes -= bytes % arg;
+		}
+		alloc = bytes / ary->sz;
+		break;
+	case ARY_GROW_CHUNKED:
+		if (!arg)
+			arg = 64;
+		if (need > SIZE_MAX - arg)
+			return need;
+		alloc = need + arg - 1;
+		alloc -= alloc % arg;
+		break;
+	default:
+		if (!arg)
+			arg = ARY_GROWTH_PERCENT;
+		alloc = (alloc <= SIZE_MAX / arg) ? alloc * arg / 100 : need;
+		break;
+	}
+	return (alloc < need) ? need : alloc;
+}
+
 static inline int (ary_grow)(struct aryb *ary, size_t extra)
 {
-	const double factor = ARY_GROWTH_FACTOR;
 	size_t alloc;
+	char *base = (char *)ary->buf - (ary->head * ary->sz);
 	void *buf;
 
 	if (ary->len + extra <= ary->alloc)
 		return 1;
-	if (ary->alloc * factor < ary->len + extra)
-		alloc = ary->len + extra;
-	else
-		alloc = ary->alloc * factor;
-	buf = ary_xrealloc(ary->buf, alloc, ary->sz);
+	/* reuse the unused memory in front of the buffer, but only if moving
+	 * the elements there pays off */
+	if (ary->head && ary->head >= ary->len &&
+	    ary->head + ary->alloc >= ary->len + extra) {
+		memmove(base, ary->buf, ary->len * ary->sz);
+		ARY_STATS_COUNT(ary, moved, ary->len * ary->sz);
+		ary->alloc += ary->head;
+		ary->head = 0;
+		ary->buf = base;
+		return 1;
+	}
+	alloc = ary_nextalloc(ary, ary->len + extra);
+	buf = ary_allocbuf(ary, base, ary->head + alloc);
 	if (!buf)
 		return 0;
 	ary->alloc = alloc;
-	ary->buf = buf;
+	ary->buf = (char *)buf + (ary->head * ary->sz);
+	ARY_STATS_GROWN(ary);
+	ARY_TRACE_RESIZE(ary);
 	return 1;
 }
 
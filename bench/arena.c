@@ -0,0 +1,71 @@
+#include <time.h>
+#include "ary.h"
+
+#define REQUESTS 20000
+#define ARRAYS 24
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* a request handler filling a couple of arrays */
+static void request(struct ary_arena *arena, unsigned *seed)
+{
+	static char str[] = "value";
+	struct ary_int ints[ARRAYS / 2];
+	struct ary_charptr strs[ARRAYS / 2];
+	size_t i, j, n;
+
+	for (i = 0; i < ARRAYS / 2; i++) {
+		if (arena) {
+			ary_init_with_alloc(&ints[i], 0, &arena->allocator);
+			ary_init_with_alloc(&strs[i], 0, &arena->allocator);
+		} else {
+			ary_init(&ints[i], 0);
+			ary_init(&strs[i], 0);
+		}
+		*seed = *seed * 1103515245 + 12345;
+		n = (*seed >> 16) % 512;
+		for (j = 0; j < n; j++)
+			ary_push(&ints[i], (int)j);
+		for (j = 0; j < n / 4; j++)
+			ary_push(&strs[i], str);
+	}
+	if (arena) {
+		ary_arena_reset(arena);
+		return;
+	}
+	for (i = 0; i < ARRAYS / 2; i++) {
+		ary_release(&ints[i]);
+		ary_release(&strs[i]);
+	}
+}
+
+int main()
+{
+	struct ary_arena arena;
+	unsigned seed;
+	double t;
+	size_t i;
+
+	seed = 1;
+	t = now();
+	for (i = 0; i < REQUESTS; i++)
+		request(NULL, &seed);
+	t = now() - t;
+	printf("realloc: %.3fs (%.0fns/request)\n", t, t / REQUESTS * 1e9);
+
+	ary_arena_init(&arena, 0);
+	seed = 1;
+	t = now();
+	for (i = 0; i < REQUESTS; i++)
+		request(&arena, &seed);
+	t = now() - t;
+	printf("arena:   %.3fs (%.0fns/request)\n", t, t / REQUESTS * 1e9);
+	ary_arena_release(&arena);
+	return 0;
+}
@@ -0,0 +1,49 @@
+# Compare two CSV files written by `ops` and report every result that got
+# slower (or allocates more) by more than `threshold` percent.
+#
+# usage: awk -v threshold=10 -f compare.awk old.csv new.csv
+#
+# Exits with 1 if there are any regressions.
+
+BEGIN {
+	FS = ","
+	if (threshold == "")
+		threshold = 10
+	bad = 0
+}
+
+FNR == 1 {
+	next
+}
+
+{
+	key = $1 "," $2 "," $3
+}
+
+# not NR == FNR, which matches the new file if the old one is empty
+FILENAME == ARGV[1] {
+	oldns[key] = $4
+	oldbytes[key] = $5
+	next
+}
+
+!(key in oldns) {
+	next
+}
+
+{
+	if (oldns[key] > 0 && ($4 - oldns[key]) * 100 / oldns[key] > threshold) {
+		printf("%s: %.3f -> %.3f ns/op (%+.1f%%)\n", key, oldns[key],
+		       $4, ($4 - oldns[key]) * 100 / oldns[key])
+		bad = 1
+	}
+	if ($5 - oldbytes[key] >= 1 &&
+	    $5 > oldbytes[key] * (1 + threshold / 100)) {
+		printf("%s: %.1f -> %.1f bytes/op\n", key, oldbytes[key], $5)
+		bad = 1
+	}
+}
+
+END {
+	exit bad
+}
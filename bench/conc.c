@@ -0,0 +1,85 @@
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include "ary.h"
+
+static size_t perthread;
+static struct ary_size_t locked;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ary_conc(size_t) conc;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *push_locked(void *arg)
+{
+	size_t i;
+
+	(void)arg;
+	for (i = 0; i < perthread; i++) {
+		pthread_mutex_lock(&lock);
+		ary_push(&locked, i);
+		pthread_mutex_unlock(&lock);
+	}
+	return NULL;
+}
+
+static void *push_conc(void *arg)
+{
+	size_t i;
+
+	(void)arg;
+	for (i = 0; i < perthread; i++)
+		ary_conc_push(&conc, &i);
+	return NULL;
+}
+
+static double run(void *(*fn)(void *), long nthreads)
+{
+	pthread_t threads[64];
+	double t = now();
+	long i;
+
+	for (i = 0; i < nthreads; i++)
+		pthread_create(&threads[i], NULL, fn, NULL);
+	for (i = 0; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+	return now() - t;
+}
+
+/* usage: conc [elements] [max threads] */
+int main(int argc, char **argv)
+{
+	size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 10000000;
+	long maxthreads = (argc > 2) ? strtol(argv[2], NULL, 10) :
+	                               sysconf(_SC_NPROCESSORS_ONLN);
+	struct ary_size_t a;
+	double tl, tc, tf;
+	long nthreads;
+
+	if (maxthreads > 64)
+		maxthreads = 64;
+	ary_conc_init(&conc);
+	for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+		perthread = n / (size_t)nthreads;
+		ary_init(&locked, 0);
+		tl = run(push_locked, nthreads);
+		ary_release(&locked);
+		tc = run(push_conc, nthreads);
+		tf = now();
+		ary_conc_freeze(&conc, &a);
+		tf = now() - tf;
+		ary_release(&a);
+		printf("%2ld threads: mutex + ary_push %9.3fms, ary_conc_push "
+		       "%9.3fms (%.2fx), ary_conc_freeze %9.3fms\n", nthreads,
+		       tl * 1e3, tc * 1e3, tl / tc, tf * 1e3);
+		if (nthreads < maxthreads && nthreads * 2 > maxthreads)
+			nthreads = maxthreads / 2;
+	}
+	return 0;
+}
@@ -0,0 +1,66 @@
+#include <time.h>
+#include "ary.h"
+
+#define PUSHES 10000000
+
+struct stats {
+	size_t reallocs;
+	size_t bytes;
+};
+
+static void *counting_realloc(void *ptr, size_t nmemb, size_t size, void *ctx)
+{
+	struct stats *stats = ctx;
+
+	stats->reallocs++;
+	stats->bytes = nmemb * size;
+	return realloc(ptr, nmemb * size);
+}
+
+static void counting_free(void *ptr, void *ctx)
+{
+	(void)ctx;
+	free(ptr);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void run(const char *name, unsigned policy, size_t arg)
+{
+	struct stats stats = {0, 0};
+	const struct ary_allocator allocator = {
+		counting_realloc, counting_free, &stats, NULL
+	};
+	struct ary_int a;
+	double t;
+	size_t i;
+
+	ary_init_with_alloc(&a, 0, &allocator);
+	ary_setgrowth(&a, policy, arg);
+	t = now();
+	for (i = 0; i < PUSHES; i++)
+		ary_push(&a, (int)i);
+	t = now() - t;
+	printf("%-16s %8zu reallocs %10zu bytes %6.2f%% overhead %6.2fns/push\n",
+	       name, stats.reallocs, stats.bytes,
+	       100.0 * (stats.bytes - a.len * sizeof(*a.buf)) /
+	       (a.len * sizeof(*a.buf)), t / PUSHES * 1e9);
+	ary_release(&a);
+}
+
+int main()
+{
+	run("geometric 2x", ARY_GROW_GEOMETRIC, 200);
+	run("geometric 1.5x", ARY_GROW_GEOMETRIC, 150);
+	run("geometric 1.25x", ARY_GROW_GEOMETRIC, 125);
+	run("rounded 4K", ARY_GROW_ROUNDED, 4096);
+	run("rounded 2M", ARY_GROW_ROUNDED, 2 * 1024 * 1024);
+	run("chunked 64K", ARY_GROW_CHUNKED, 64 * 1024);
+	return 0;
+}
@@ -0,0 +1,64 @@
+#include <time.h>
+#include "ary.h"
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the naive loop ary_index() used to be */
+static size_t naive_index(const void *buf, size_t len, size_t sz,
+                          const void *data)
+{
+	const char *elem = buf;
+	size_t i;
+
+	for (i = 0; i < len; i++, elem += sz) {
+		if (!memcmp(elem, data, sz))
+			return i;
+	}
+	return len;
+}
+
+#define BENCH(name, type)                                                     \
+	do {                                                                  \
+		type a;                                                       \
+		double t1, t2;                                                \
+		size_t i, pos, sum1 = 0, sum2 = 0;                            \
+                                                                              \
+		ary_init(&a, n);                                              \
+		for (i = 0; i < n; i++)                                       \
+			ary_push(&a, 1);                                      \
+		a.val = 2;                                                    \
+		ary_push(&a, a.val);                                          \
+		t1 = now();                                                   \
+		for (i = 0; i < rounds; i++)                                  \
+			sum1 += naive_index(a.buf, a.len, sizeof(*a.buf),     \
+			                    &a.val);                          \
+		t1 = now() - t1;                                              \
+		t2 = now();                                                   \
+		for (i = 0; i < rounds; i++)                                  \
+			if (ary_index(&a, &pos, 0, &a.val, NULL))             \
+				sum2 += pos;                                  \
+		t2 = now() - t2;                                              \
+		printf("%-6s %10zu: memcmp loop %9.3fms  ary_index %9.3fms " \
+		       "(%.1fx)\n", name, n, t1 * 1e3, t2 * 1e3, t1 / t2);    \
+		if (sum1 != rounds * n || sum2 != sum1)                       \
+			printf("mismatch!\n");                                \
+		ary_release(&a);                                              \
+	} while (0)
+
+int main()
+{
+	size_t n, rounds;
+
+	for (n = 1000, rounds = 10000; n <= 10000000; n *= 100, rounds /= 100) {
+		BENCH("char", struct ary_char);
+		BENCH("int", struct ary_int);
+		BENCH("vlong", struct ary_vlong);
+	}
+	return 0;
+}
@@ -0,0 +1,273 @@
+#include <time.h>
+#include <unistd.h>
+#include "ary.h"
+
+/* Microbenchmarks of the basic operations across element sizes and lengths.
+ * Prints CSV, one line per operation, element size and length:
+ *
+ *	op,elem_size,length,ns_per_op,bytes_per_op
+ *
+ * where an op is:
+ *	push: one ary_push() onto an array that grows to `length`
+ *	splice: inserting and removing an element in the middle
+ *	shift: one ary_shift()
+ *	index: one ary_index() of a missing element (a full scan)
+ *	sort: ary_sort() per element
+ *	unique: ary_unique() per element (every element occurs twice)
+ *	join: ary_join_append() per element
+ *	release: one ary_release()
+ *
+ * and bytes_per_op is the memory requested from the allocator per op. Compare
+ * two runs with compare.awk. */
+
+enum { PUSH, SPLICE, SHIFT, INDEX, SORT, UNIQUE, JOIN, RELEASE, NOPS };
+
+static const char *opnames[NOPS] = {
+	"push", "splice", "shift", "index", "sort", "unique", "join", "release"
+};
+
+/* total size of the arrays that are set up for a single measurement */
+#define BATCH_BYTES (32 << 20)
+/* times to splice, shift or index a single array before setting it up anew */
+#define REPEAT 16
+
+static size_t allocated;
+
+static void *countrealloc(void *ptr, size_t nmemb, size_t size)
+{
+	if (size && nmemb > SIZE_MAX / size)
+		return NULL;
+	allocated += nmemb * size;
+	return realloc(ptr, nmemb * size);
+}
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long long rnd(void)
+{
+	static unsigned long long x = 88172645463325252ULL;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+/* element `i` of `n` distinct ones (`i` < `n`), the rest of it is 0 */
+static void mkelem(unsigned char *elem, size_t sz, size_t i)
+{
+	memset(elem, 0, sz);
+	memcpy(elem, &i, (sz < sizeof(i)) ? sz : sizeof(i));
+}
+
+/* define the setup, operation and teardown for elements of `n` bytes, the
+ * operations return the number of ops done */
+#define BENCH_DEFINE(n)                                                        \
+	struct elem##n {                                                       \
+		unsigned char b[n];                                            \
+	};                                                                     \
+	struct ary_e##n ary(struct elem##n);                                   \
+	static struct ary_e##n *arys##n;                                       \
+                                                                               \
+	static int cmp##n(const void *a, const void *b)                        \
+	{                                                                      \
+		return memcmp(a, b, n);                                        \
+	}                                                                      \
+                                                                               \
+	static int append##n(struct ary_char *out, const void *elem)           \
+	{                                                                      \
+		return ary_extend(out, (const char *)elem, n);                 \
+	}                                                                      \
+                                                                               \
+	static void setup##n(int op, size_t len, size_t batch)                 \
+	{                                                                      \
+		struct elem##n e;                                              \
+		size_t b, i, vals = (op == UNIQUE) ? len / 2 + 1 : len;        \
+                                                                               \
+		arys##n = malloc(batch * sizeof(*arys##n));                    \
+		for (b = 0; b < batch; b++) {                                  \
+			ary_init(&arys##n[b], (op == PUSH) ? 0 : len + 1);     \
+			for (i = 0; op != PUSH && i < len; i++) {              \
+				mkelem(e.b, n, (op == INDEX) ? 0 :             \
+				       (size_t)(rnd() % vals));                \
+				ary_push(&arys##n[b], e);                      \
+			}                                                      \
+		}                                                              \
+	}                                                                      \
+                                                                               \
+	static size_t run##n(int op, size_t len, size_t batch)                 \
+	{                                                                      \
+		struct ary_char out;                                           \
+		struct elem##n e;                                              \
+		size_t b, i, pos, ops = 0;                                     \
+                                                                               \
+		mkelem(e.b, n, (size_t)-1);                                    \
+		ary_init(&out, 0);                                             \
+		for (b = 0; b < batch; b++) {                                  \
+			struct ary_e##n *a = &arys##n[b];                      \
+                                                                               \
+			switch (op) {                                          \
+			case PUSH:                                             \
+				for (i = 0; i < len; i++)                      \
+					ary_push(a, e);                        \
+				ops += len;                                    \
+				break;                                         \
+			case SPLICE:                                           \
+				for (i = 0; i < REPEAT; i++) {                 \
+					ary_insert(a, len / 2, e);             \
+					ary_remove(a, len / 2);                \
+				}                                              \
+				ops += REPEAT;                                 \
+				break;                                         \
+			case SHIFT:                                            \
+				for (i = 0; i < REPEAT && i < len; i++)        \
+					ary_shift(a, NULL);                    \
+				ops += i;                                      \
+				break;                                         \
+			case INDEX:                                            \
+				for (i = 0; i < REPEAT; i++)                   \
+					ary_index(a, &pos, 0, &e, NULL);       \
+				ops += REPEAT;                                 \
+				break;                                         \
+			case SORT:                                             \
+				ary_sort(a, cmp##n);                           \
+				ops += len;                                    \
+				break;                                         \
+			case UNIQUE:                                           \
+				ary_unique(a, cmp##n);                         \
+				ops += len;                                    \
+				break;                                         \
+			case JOIN:                                             \
+				ary_clear(&out);                               \
+				ary_join_append(a, &out, ",", append##n,       \
+				                n);                            \
+				ops += len;                                    \
+				break;                                         \
+			case RELEASE:                                          \
+				ary_release(a);                                \
+				ops++;                                         \
+				break;                                         \
+			}                                                      \
+		}                                                              \
+		ary_release(&out);                                             \
+		return ops;                                                    \
+	}                                                                      \
+                                                                               \
+	static void teardown##n(size_t batch)                                  \
+	{                                                                      \
+		size_t b;                                                      \
+                                                                               \
+		for (b = 0; b < batch; b++)                                    \
+			ary_release(&arys##n[b]);                              \
+		free(arys##n);                                                 \
+	}
+
+BENCH_DEFINE(1)
+BENCH_DEFINE(2)
+BENCH_DEFINE(4)
+BENCH_DEFINE(8)
+BENCH_DEFINE(16)
+BENCH_DEFINE(32)
+BENCH_DEFINE(64)
+BENCH_DEFINE(128)
+BENCH_DEFINE(256)
+
+struct sizebench {
+	size_t sz;
+	void (*setup)(int op, size_t len, size_t batch);
+	size_t (*run)(int op, size_t len, size_t batch);
+	void (*teardown)(size_t batch);
+};
+
+#define SIZEBENCH(n) { n, setup##n, run##n, teardown##n }
+
+static const struct sizebench sizes[] = {
+	SIZEBENCH(1), SIZEBENCH(2), SIZEBENCH(4), SIZEBENCH(8), SIZEBENCH(16),
+	SIZEBENCH(32), SIZEBENCH(64), SIZEBENCH(128), SIZEBENCH(256)
+};
+
+/* run an operation repeatedly for at least `mintime` seconds */
+static void measure(const struct sizebench *sb, int op, size_t len,
+                    double mintime)
+{
+	size_t batch = BATCH_BYTES / (len * sb->sz + 64), ops = 0;
+	size_t bytes = 0;
+	double t, total = 0;
+
+	if (batch > 4096)
+		batch = 4096;
+	if (!batch)
+		batch = 1;
+	do {
+		sb->setup(op, len, batch);
+		allocated = 0;
+		t = now();
+		ops += sb->run(op, len, batch);
+		total += now() - t;
+		bytes += allocated;
+		sb->teardown(batch);
+	} while (total < mintime);
+	printf("%s,%zu,%zu,%.3f,%.1f\n", opnames[op], sb->sz, len,
+	       total * 1e9 / (double)ops, (double)bytes / (double)ops);
+	fflush(stdout);
+}
+
+/* usage: ops [-l max length] [-m max bytes per array] [-t min ms per result]
+ *            [-o op] [-s element size] */
+int main(int argc, char **argv)
+{
+	size_t maxlen = 100000, maxbytes = (size_t)1 << 30, onlysz = 0, len;
+	double mintime = 0.05;
+	const char *onlyop = NULL;
+	int opt, op;
+	size_t i;
+
+	while ((opt = getopt(argc, argv, "l:m:t:o:s:")) != -1) {
+		switch (opt) {
+		case 'l':
+			maxlen = strtoul(optarg, NULL, 10);
+			break;
+		case 'm':
+			maxbytes = strtoul(optarg, NULL, 10);
+			break;
+		case 't':
+			mintime = strtod(optarg, NULL) / 1e3;
+			break;
+		case 'o':
+			onlyop = optarg;
+			break;
+		case 's':
+			onlysz = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-l max length] [-m max "
+			        "bytes] [-t min ms] [-o op] [-s size]\n",
+			        argv[0]);
+			return 1;
+		}
+	}
+	ary_use_as_realloc(countrealloc);
+	printf("op,elem_size,length,ns_per_op,bytes_per_op\n");
+	for (op = 0; op < NOPS; op++) {
+		if (onlyop && strcmp(onlyop, opnames[op]))
+			continue;
+		for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+			if (onlysz && onlysz != sizes[i].sz)
+				continue;
+			for (len = 10; len <= maxlen; len *= 10) {
+				if (len > maxbytes / sizes[i].sz)
+					break;
+				measure(&sizes[i], op, len, mintime);
+				if (len > SIZE_MAX / 10)
+					break;
+			}
+		}
+	}
+	return 0;
+}
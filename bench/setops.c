@@ -0,0 +1,70 @@
+#include <time.h>
+#include "ary.h"
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long long rnd(void)
+{
+	static unsigned long long x = 88172645463325252ULL;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+/* a sorted posting list of `n` ids below `range` */
+static void fill(struct ary_int *a, size_t n, size_t range)
+{
+	size_t i;
+
+	ary_init(a, n);
+	for (i = 0; i < n; i++)
+		ary_push(a, (int)(rnd() % range));
+	ary_sort_int(a);
+	ary_unique_sorted(a, ary_cb_cmpint);
+}
+
+static void bench(size_t na, size_t nb)
+{
+	struct ary_int a, b, r, naive;
+	double t1, t2;
+	size_t i, range = (na > nb ? na : nb) * 4;
+
+	fill(&a, na, range);
+	fill(&b, nb, range);
+	ary_init(&naive, 0);
+	t1 = now();
+	for (i = 0; i < a.len; i++) {
+		if (ary_index(&b, NULL, 0, &a.buf[i], NULL))
+			ary_push(&naive, a.buf[i]);
+	}
+	t1 = now() - t1;
+	t2 = now();
+	ary_set_intersect(&a, &b, &r, ary_cb_cmpint);
+	t2 = now() - t2;
+	if (r.len != naive.len || memcmp(r.buf, naive.buf, r.len * sizeof(int)))
+		printf("mismatch!\n");
+	printf("%8zu x %8zu: ary_index loop %10.3fms  ary_set_intersect "
+	       "%8.3fms (%.0fx)\n", a.len, b.len, t1 * 1e3, t2 * 1e3, t1 / t2);
+	ary_release(&a);
+	ary_release(&b);
+	ary_release(&r);
+	ary_release(&naive);
+}
+
+int main()
+{
+	bench(1000, 1000);
+	bench(10000, 10000);
+	bench(100, 100000);
+	bench(100000, 100);
+	bench(30000, 30000);
+	return 0;
+}
@@ -0,0 +1,59 @@
+#include <time.h>
+#include "ary.h"
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long long rnd(void)
+{
+	static unsigned long long x = 88172645463325252ULL;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+#define BENCH(name, type, fill, qcmp, sort)                                  \
+	do {                                                                 \
+		type a, b;                                                   \
+		double t1, t2;                                               \
+		size_t i;                                                    \
+                                                                             \
+		ary_init(&a, n);                                             \
+		for (i = 0; i < n; i++)                                      \
+			ary_push(&a, fill);                                  \
+		ary_clone(&a, &b);                                           \
+		t1 = now();                                                  \
+		ary_sort(&a, qcmp);                                          \
+		t1 = now() - t1;                                             \
+		t2 = now();                                                  \
+		sort(&b);                                                    \
+		t2 = now() - t2;                                             \
+		if (memcmp(a.buf, b.buf, n * sizeof(*a.buf)))                \
+			printf("mismatch!\n");                               \
+		printf("%-8s %10zu: ary_sort %9.3fms  specialized %9.3fms " \
+		       "(%.1fx)\n", name, n, t1 * 1e3, t2 * 1e3, t1 / t2);   \
+		ary_release(&a);                                             \
+		ary_release(&b);                                             \
+	} while (0)
+
+int main()
+{
+	size_t n;
+
+	for (n = 1000; n <= 10000000; n *= 100) {
+		BENCH("int", struct ary_int, (int)rnd(), ary_cb_cmpint,
+		      ary_sort_int);
+		BENCH("vlong", struct ary_vlong, (long long)rnd(),
+		      ary_cb_cmpvlong, ary_sort_vlong);
+		BENCH("double", struct ary_double, (double)rnd() / 3.0,
+		      ary_cb_cmpdouble, ary_sort_double);
+	}
+	return 0;
+}
@@ -0,0 +1,65 @@
+#include <time.h>
+#include <unistd.h>
+#include "ary.h"
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static unsigned long long rnd(void)
+{
+	static unsigned long long x = 88172645463325252ULL;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+/* usage: sort_parallel [elements] [max threads] */
+int main(int argc, char **argv)
+{
+	size_t n = (argc > 1) ? strtoul(argv[1], NULL, 10) : 10000000;
+	long maxthreads = (argc > 2) ? strtol(argv[2], NULL, 10) :
+	                               sysconf(_SC_NPROCESSORS_ONLN);
+	struct ary_vlong orig, a;
+	double t, base;
+	size_t i;
+	long nthreads;
+
+	ary_init(&orig, n);
+	for (i = 0; i < n; i++)
+		ary_push(&orig, (long long)rnd());
+
+	ary_clone(&orig, &a);
+	t = now();
+	ary_sort(&a, ary_cb_cmpvlong);
+	base = now() - t;
+	printf("ary_sort:              %9.3fms\n", base * 1e3);
+	ary_release(&a);
+
+	for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+		ary_clone(&orig, &a);
+		t = now();
+		ary_sort_parallel(&a, ary_cb_cmpvlong, (size_t)nthreads);
+		t = now() - t;
+		for (i = 1; i < a.len && a.buf[i - 1] <= a.buf[i]; i++)
+			;
+		if (i < a.len) {
+			fprintf(stderr, "ary_sort_parallel(%ld) didn't sort\n",
+			        nthreads);
+			return 1;
+		}
+		printf("ary_sort_parallel(%2ld): %9.3fms (%.2fx)\n", nthreads,
+		       t * 1e3, base / t);
+		ary_release(&a);
+		if (nthreads < maxthreads && nthreads * 2 > maxthreads)
+			nthreads = maxthreads / 2;
+	}
+	ary_release(&orig);
+	return 0;
+}
@@ -0,0 +1,90 @@
+#include "tap.h"
+#include "ary.h"
+
+struct counts {
+	size_t reallocs, frees, trims, nmemb, used;
+	void *ptr;
+};
+
+struct ary_int a;
+struct counts cnt;
+
+static void *countrealloc(void *ptr, size_t nmemb, size_t size, void *ctx)
+{
+	struct counts *c = ctx;
+
+	c->reallocs++;
+	c->nmemb = nmemb;
+	return c->ptr = realloc(ptr, nmemb * size);
+}
+
+static void countfree(void *ptr, void *ctx)
+{
+	struct counts *c = ctx;
+
+	c->frees++;
+	c->ptr = ptr;
+	free(ptr);
+}
+
+static void counttrim(void *ptr, size_t used, void *ctx)
+{
+	struct counts *c = ctx;
+
+	(void)ptr;
+	c->trims++;
+	c->used = used;
+}
+
+static void *failrealloc(void *ptr, size_t nmemb, size_t size)
+{
+	(void)ptr;
+	(void)nmemb;
+	(void)size;
+	return NULL;
+}
+
+int main()
+{
+	struct ary_allocator allocator = {
+		countrealloc, countfree, &cnt, counttrim
+	};
+	ary_xalloc_t xrealloc = ary_xrealloc;
+	size_t reallocs;
+	int i;
+
+	/* nothing may end up at the default allocator */
+	ary_use_as_realloc(failrealloc);
+
+	ok(ary_init_with_alloc(&a, 10, &allocator), "Initialized Array");
+	ok(cnt.reallocs == 1 && cnt.nmemb == 10, "allocating 10 elements");
+	for (i = 0; i < 100; i++)
+		ary_push(&a, i);
+	ok(a.len == 100 && cnt.ptr == a.buf, "Grew Array with its allocator");
+	ok(cnt.reallocs > 1 && cnt.reallocs < 100, "geometrically");
+
+	reallocs = cnt.reallocs;
+	ary_setlen(&a, 90);
+	is(cnt.trims, (size_t)0, "%zu", "Shortening a little trims nothing");
+	ary_setlen(&a, 40);
+	is(cnt.trims, (size_t)1, "%zu", "Halving the length trims");
+	is(cnt.used, 40 * sizeof(int), "%zu", "all but the elements left");
+	is(cnt.reallocs, reallocs, "%zu", "without reallocating");
+
+	ok(ary_shrinktofit(&a), "Shrunk Array");
+	ok(cnt.reallocs == reallocs + 1 && cnt.nmemb == 40,
+	   "with its allocator");
+	ary_clear(&a);
+	ary_shrinktofit(&a);
+	ok(cnt.frees == 1 && !a.buf, "Shrinking an empty Array frees it");
+
+	ary_push(&a, 1);
+	cnt.frees = 0;
+	cnt.ptr = NULL;
+	ary_release(&a);
+	ok(cnt.frees == 1 && cnt.ptr, "Released Array with its allocator");
+
+	ary_use_as_realloc(xrealloc);
+
+	done_testing();
+}
@@ -0,0 +1,34 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary(int) a, b;
+struct ary_arena arena;
+
+int main()
+{
+	int *buf, i, sum;
+
+	ary_arena_init(&arena, 1024);
+	ok(ary_init_with_alloc(&a, 4, &arena.allocator), "Initialized Array");
+	ary_push(&a, 1);
+	buf = a.buf;
+	ok(ary_grow(&a, 100), "Grew Array");
+	ok(a.buf == buf, "The most recent allocation was extended in place");
+
+	ary_init_with_alloc(&b, 0, &arena.allocator);
+	for (i = 0; i < 1000; i++)
+		ary_push(&b, i);
+	for (i = 0, sum = 0; i < 1000; i++)
+		sum += b.buf[i] == i;
+	is(sum, 1000, "%d", "Array spanning multiple blocks is intact");
+	is(a.buf[0], 1, "%d", "Other array is intact");
+
+	ary_arena_reset(&arena);
+	ok(arena.blk && !arena.last, "Reset kept a block");
+	ary_init_with_alloc(&a, 0, &arena.allocator);
+	ok(ary_push(&a, 2), "Pushed to Array after reset");
+	ary_release(&a);
+	ary_arena_release(&arena);
+
+	done_testing();
+}
@@ -0,0 +1,74 @@
+#include <pthread.h>
+#include "tap.h"
+#include "ary.h"
+
+#define NTHREADS 4
+#define PERTHREAD 10000
+
+struct ary_conc(int) c;
+struct ary_int a;
+
+static void *producer(void *arg)
+{
+	int i, v;
+
+	for (i = 0; i < PERTHREAD; i++) {
+		v = *(int *)arg * PERTHREAD + i;
+		if (!ary_conc_push(&c, &v))
+			break;
+	}
+	return NULL;
+}
+
+static void *failrealloc(void *ptr, size_t nmemb, size_t size)
+{
+	(void)ptr;
+	(void)nmemb;
+	(void)size;
+	return NULL;
+}
+
+int main()
+{
+	ary_xalloc_t xrealloc = ary_xrealloc;
+	pthread_t threads[NTHREADS];
+	int ids[NTHREADS], *p, v = 42, seen = 1;
+	size_t i;
+
+	ary_conc_init(&c);
+	ok(ary_conc_push(&c, &v), "Pushed 42 to the concurrent Array");
+	p = ary_conc_pushp(&c);
+	ok(p != NULL, "Added a slot");
+	*p = 43;
+	is(ary_conc_len(&c), (size_t)2, "%zu", "It now has 2 elements");
+	is(*(int *)ary_conc_at(&c, 1), 43, "%d", "2. element is 43");
+	ok(ary_conc_at(&c, 2) == NULL, "3. element doesn't exist");
+	ary_conc_release(&c);
+	is(ary_conc_len(&c), (size_t)0, "%zu", "Released it");
+
+	ary_use_as_realloc(failrealloc);
+	ok(!ary_conc_pushp(&c), "Adding a slot fails without memory");
+	ok(ary_conc_at(&c, 0) == NULL, "its reserved slot doesn't exist");
+	ary_use_as_realloc(xrealloc);
+	ary_conc_release(&c);
+
+	for (i = 0; i < NTHREADS; i++) {
+		ids[i] = (int)i;
+		pthread_create(&threads[i], NULL, producer, &ids[i]);
+	}
+	for (i = 0; i < NTHREADS; i++)
+		pthread_join(threads[i], NULL);
+	is(ary_conc_len(&c), (size_t)NTHREADS * PERTHREAD, "%zu",
+	   "4 threads pushed 10000 elements each");
+
+	ok(ary_conc_freeze(&c, &a), "Froze the concurrent Array");
+	is(a.len, (size_t)NTHREADS * PERTHREAD, "%zu", "into an Array");
+	is(ary_conc_len(&c), (size_t)0, "%zu", "which is empty now");
+	ary_sort_int(&a);
+	for (i = 0; i < a.len; i++)
+		seen &= a.buf[i] == (int)i;
+	ok(seen, "every element is there once");
+	ary_release(&a);
+
+	done_testing();
+}
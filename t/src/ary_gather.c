@@ -0,0 +1,79 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_int parts[6];
+struct ary_int all;
+
+/* if `all` ends with the elements of the first `n` parts */
+static int gathered(size_t n)
+{
+	size_t i, j, len = 0;
+
+	for (i = 0; i < n; i++)
+		len += parts[i].len;
+	if (all.len < len)
+		return 0;
+	for (i = 0, j = all.len - len; i < n; j += parts[i++].len)
+		if (parts[i].len && memcmp(&all.buf[j], parts[i].buf,
+		                           parts[i].len * sizeof(int)))
+			return 0;
+	return 1;
+}
+
+static void fill(size_t k, size_t n)
+{
+	size_t j;
+
+	ary_clear(&parts[k]);
+	for (j = 0; j < n; j++)
+		ary_push(&parts[k], (int)(k * 10000000 + j));
+}
+
+int main()
+{
+	size_t i;
+
+	ary_init(&all, 0);
+	ary_push(&all, -1);
+	for (i = 0; i < 6; i++)
+		ary_init(&parts[i], 0);
+
+	/* 12 MB, the ranges of the threads start in the middle of parts */
+	for (i = 0; i < 4; i++)
+		fill(i, (i + 1) * 300000);
+	ok(ary_gather(&all, parts, 4, 4), "Gathered 4 Arrays in parallel");
+	is(all.len, (size_t)3000001, "%zu", "It now has 3000001 elements");
+	ok(all.buf[0] == -1 && gathered(4), "which were appended in order");
+	ok(ary_gather(&all, parts, 1, 1), "Gathered a single Array");
+	is(all.len, (size_t)3300001, "%zu", "It now has 3300001 elements");
+	ok(gathered(1), "which was appended");
+
+	/* 8 threads all within a single part */
+	ary_clear(&all);
+	fill(0, 2000000);
+	ok(ary_gather(&all, parts, 1, 8), "Gathered one Array with 8 threads");
+	ok(all.len == 2000000 && gathered(1), "which was copied");
+
+	/* 3 threads, the second and third ones start behind empty parts */
+	ary_clear(&all);
+	fill(0, 0);
+	fill(1, 500000);
+	fill(2, 0);
+	fill(3, 0);
+	fill(4, 700000);
+	fill(5, 0);
+	ok(ary_gather(&all, parts, 6, 3), "Gathered with empty Arrays");
+	ok(all.len == 1200000 && gathered(6), "which were skipped");
+
+	for (i = 0; i < 6; i++)
+		fill(i, 0);
+	ok(ary_gather(&all, parts, 6, 0), "Gathered only empty Arrays");
+	is(all.len, (size_t)1200000, "%zu", "which added nothing");
+	ok(ary_gather(&all, parts, 0, 0), "Gathered no Arrays at all");
+
+	for (i = 0; i < 6; i++)
+		ary_release(&parts[i]);
+	ary_release(&all);
+
+	done_testing();
+}
@@ -0,0 +1,71 @@
+#include "tap.h"
+#include "ary.h"
+
+struct rgb {
+	unsigned char c[12];
+};
+
+struct ary_int a;
+struct ary(struct rgb) b;
+
+/* the first `n` capacities of `a` while pushing to it */
+static int grows(size_t *expect, size_t n)
+{
+	size_t i = 0, alloc = a.s.alloc;
+
+	while (i < n) {
+		ary_push(&a, 0);
+		if (a.s.alloc != alloc && a.s.alloc != expect[i++])
+			return 0;
+		alloc = a.s.alloc;
+	}
+	return 1;
+}
+
+int main()
+{
+	size_t geo[] = { 1, 2, 4, 8, 16, 32 };
+	size_t geo150[] = { 1, 2, 3, 4, 6, 9, 13, 19, 28 };
+	size_t rounded[] = { 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048,
+	                     4096 };
+	size_t rounded100[] = { 4, 8, 16, 50, 100, 200, 400 };
+	size_t chunked[] = { 64, 128, 192, 256 };
+	size_t chunked10[] = { 10, 20, 30 };
+	size_t odd[6], i;
+
+	ary_init(&a, 0);
+	ok(grows(geo, 6), "Geometric growth doubles by default");
+	ary_release(&a);
+	ary_setgrowth(&a, ARY_GROW_GEOMETRIC, 150);
+	ok(grows(geo150, 9), "or multiplies by a given percentage");
+	ary_release(&a);
+
+	ary_setgrowth(&a, ARY_GROW_ROUNDED, 0);
+	ok(grows(rounded, 11), "Rounded growth doubles by default");
+	ary_release(&a);
+	ary_setgrowth(&a, ARY_GROW_ROUNDED, 100);
+	ok(grows(rounded100, 7), "up to a given size, then to its multiples");
+	ary_release(&a);
+
+	ary_setgrowth(&a, ARY_GROW_CHUNKED, 0);
+	ok(grows(chunked, 4), "Chunked growth adds 64 elements by default");
+	ary_release(&a);
+	ary_setgrowth(&a, ARY_GROW_CHUNKED, 10);
+	ok(grows(chunked10, 3), "or the given number");
+	ok(ary_grow(&a, 100) && a.s.alloc == 130, "or as many as requested");
+	ary_release(&a);
+
+	ary_init(&b, 0);
+	ary_setgrowth(&b, ARY_GROW_ROUNDED, 0);
+	for (i = 0; i < 6; i++) {
+		ary_grow(&b, b.s.alloc - b.len + 1);
+		odd[i] = b.s.alloc;
+		ary_setlen(&b, b.s.alloc);
+	}
+	ok(odd[0] == 1 && odd[1] == 2 && odd[2] == 5 && odd[3] == 10 &&
+	   odd[4] == 21 && odd[5] == 42,
+	   "Rounding sizes in bytes, not elements");
+	ary_release(&b);
+
+	done_testing();
+}
@@ -0,0 +1,69 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_int a;
+struct ary_charptr s;
+
+int main()
+{
+	int vals[] = {5, 7, 9, 7, 3}, key;
+	char *str = "bar";
+	size_t pos;
+
+	ary_init(&a, 0);
+	ary_extend(&a, vals, 5);
+	ok(ary_sethashidx(&a, ary_cb_hashbytes, NULL), "Created a hash index");
+
+	key = 7;
+	ok(ary_index(&a, &pos, 0, &key, NULL), "Found 7");
+	is(pos, (size_t)1, "%zu", "at position 1");
+	ok(ary_index(&a, &pos, 2, &key, NULL), "Found 7 from position 2 on");
+	is(pos, (size_t)3, "%zu", "at position 3");
+	ok(!ary_index(&a, &pos, 4, &key, NULL), "but not from position 4 on");
+
+	key = 11;
+	ary_push(&a, 11);
+	ok(ary_index(&a, &pos, 0, &key, NULL), "Found the pushed 11");
+	is(pos, (size_t)5, "%zu", "at position 5");
+	ary_pop(&a, NULL);
+	ok(!ary_index(&a, &pos, 0, &key, NULL), "Popped 11 isn't found");
+	ary_push(&a, 13);
+	ok(!ary_index(&a, &pos, 0, &key, NULL), "not after pushing 13 either");
+
+	key = 5;
+	ary_shift(&a, NULL);
+	ok(!ary_index(&a, &pos, 0, &key, NULL), "Shifted 5 isn't found");
+	key = 9;
+	ok(ary_index(&a, &pos, 0, &key, NULL), "Found 9 after shifting");
+	is(pos, (size_t)1, "%zu", "at position 1");
+
+	ary_sort_int(&a);
+	ok(ary_index(&a, &pos, 0, &key, NULL), "Found 9 after sorting");
+	is(pos, (size_t)3, "%zu", "at position 3");
+	ary_insert(&a, 0, 1);
+	ok(ary_index(&a, &pos, 0, &key, NULL), "Found 9 after inserting");
+	is(pos, (size_t)4, "%zu", "at position 4");
+
+	a.buf[4] = 2;
+	ary_hashidx_invalidate(&a);
+	ok(!ary_index(&a, &pos, 0, &key, NULL), "Overwritten 9 isn't found");
+	key = 2;
+	ok(ary_index(&a, &pos, 0, &key, NULL), "but 2 is");
+	is(pos, (size_t)4, "%zu", "at position 4");
+
+	ary_setlen(&a, 2);
+	ok(!ary_index(&a, &pos, 0, &key, NULL), "Truncated 2 isn't found");
+	ary_release(&a);
+	ok(a.s.hidx == NULL, "Releasing drops the index");
+
+	ary_init(&s, 0);
+	ary_push(&s, "foo");
+	ary_push(&s, "bar");
+	ok(ary_sethashidx(&s, ary_cb_hashstr, ary_cb_strcmp),
+	   "Created a hash index of strings");
+	ok(ary_index(&s, &pos, 0, &str, ary_cb_strcmp), "Found bar");
+	is(pos, (size_t)1, "%zu", "at position 1");
+	ary_release(&s);
+
+	done_testing();
+}
@@ -0,0 +1,67 @@
+#include "tap.h"
+#include "ary.h"
+
+struct wide {
+	char c[16];
+};
+
+struct ary_int a;
+struct ary_size_t pos;
+struct ary(struct wide) w;
+
+int main()
+{
+	struct wide wide = {{0}};
+	size_t i, ret;
+	int x = 7;
+
+	ary_init(&a, 0);
+	ary_init(&pos, 0);
+	ok(!ary_index(&a, &ret, 0, &x, NULL), "Nothing found in an empty array");
+	ok(!ary_rindex(&a, &ret, 0, &x, NULL), "not even backwards");
+
+	for (i = 0; i < 1000; i++)
+		ary_push(&a, (int)(i % 100));
+	x = 42;
+	ok(ary_index(&a, &ret, 0, &x, NULL), "Found 42");
+	is(ret, (size_t)42, "%zu", "at position 42");
+	ok(ary_index(&a, &ret, 43, &x, NULL), "Found 42 after position 42");
+	is(ret, (size_t)142, "%zu", "at position 142");
+	ok(ary_rindex(&a, &ret, 999, &x, NULL), "Found 42 backwards");
+	is(ret, (size_t)942, "%zu", "at position 942");
+	ok(ary_rindex(&a, &ret, 941, &x, NULL), "Found 42 before position 942");
+	is(ret, (size_t)842, "%zu", "at position 842");
+	x = 0;
+	ok(ary_rindex(&a, &ret, 50, &x, NULL), "Found 0 backwards");
+	is(ret, (size_t)0, "%zu", "at position 0");
+	x = 100;
+	ok(!ary_index(&a, &ret, 0, &x, NULL), "100 isn't there");
+
+	x = 99;
+	is(ary_count(&a, 0, &x, NULL), (size_t)10, "%zu", "99 occurs 10 times");
+	is(ary_count(&a, 0, &x, ary_cb_cmpint), (size_t)10, "%zu",
+	   "also with a comparison function");
+	is(ary_count(&a, 500, &x, NULL), (size_t)5, "%zu",
+	   "5 times after position 500");
+	ok(ary_indexall(&a, &pos, 0, &x, NULL), "Got all positions of 99");
+	is(pos.len, (size_t)10, "%zu", "10 of them");
+	for (i = 0; i < pos.len && pos.buf[i] == i * 100 + 99; i++)
+		;
+	is(i, (size_t)10, "%zu", "in ascending order");
+	ary_release(&a);
+	ary_release(&pos);
+
+	ary_init(&w, 0);
+	for (i = 0; i < 50; i++) {
+		wide.c[15] = (char)i;
+		ary_push(&w, wide);
+	}
+	wide.c[15] = 33;
+	ok(ary_index(&w, &ret, 0, &wide, NULL), "Found a 16-byte element");
+	is(ret, (size_t)33, "%zu", "at position 33");
+	ok(ary_rindex(&w, &ret, 49, &wide, NULL), "Found it backwards");
+	is(ret, (size_t)33, "%zu", "at the same position");
+	ary_release(&w);
+
+	done_testing();
+}
@@ -0,0 +1,76 @@
+#include <limits.h>
+#include "tap.h"
+#include "ary.h"
+
+struct ary_int ints;
+struct ary_vlong vlongs;
+struct ary_double doubles;
+struct ary_charptr strs;
+struct ary_char out;
+
+int main()
+{
+	double dvals[] = {0.0, -0.0, 1.0, -42.0, 999999.0, 1e6, 0.1, -2.5,
+	                  1e-5, 123456.7, 1e300};
+	char *str, *olds;
+	size_t i;
+
+	ary_init(&ints, 0);
+	ary_init(&vlongs, 0);
+	ary_init(&doubles, 0);
+	ary_init(&strs, 0);
+	ary_init(&out, 0);
+
+	ary_push(&ints, 0);
+	ary_push(&ints, 7);
+	ary_push(&ints, -10);
+	ary_push(&ints, INT_MAX);
+	ary_push(&ints, INT_MIN);
+	ok(ary_join_append(&ints, &out, ", ", ary_cb_appendint, 0),
+	   "Joined ints");
+	ary_join(&ints, &str, ", ", ary_cb_inttostr);
+	ok(!strcmp(out.buf, str), "just like ary_join()");
+	is(out.len, strlen(str), "%zu", "the terminator isn't counted");
+	free(str);
+
+	ary_push(&vlongs, LLONG_MIN);
+	ary_push(&vlongs, LLONG_MAX);
+	ary_push(&vlongs, 100);
+	ary_clear(&out);
+	ok(ary_join_append(&vlongs, &out, "|", ary_cb_appendvlong, 20),
+	   "Joined long longs with a hint");
+	ary_join(&vlongs, &str, "|", ary_cb_vlongtostr);
+	ok(!strcmp(out.buf, str), "just like ary_join()");
+	free(str);
+
+	for (i = 0; i < sizeof(dvals) / sizeof(dvals[0]); i++)
+		ary_push(&doubles, dvals[i]);
+	ary_clear(&out);
+	ok(ary_join_append(&doubles, &out, " ", ary_cb_appenddouble, 8),
+	   "Joined doubles");
+	ary_join(&doubles, &str, " ", ary_cb_doubletostr);
+	ok(!strcmp(out.buf, str), "just like ary_join()");
+	free(str);
+
+	ary_push(&strs, "a");
+	ary_push(&strs, NULL);
+	ary_push(&strs, "bc");
+	ary_push(&strs, "");
+	ary_clear(&out);
+	ary_push(&out, '>');
+	ok(ary_join_append(&strs, &out, "-", NULL, 0), "Joined strings");
+	ok(!strcmp(out.buf, ">a-bc-"), "appended after the existing content");
+
+	ary_clear(&out);
+	olds = out.buf;
+	ok(ary_join_append(&ints, &out, ",", ary_cb_appendint, 0) &&
+	   out.buf == olds, "Joined again without reallocating");
+
+	ary_release(&ints);
+	ary_release(&vlongs);
+	ary_release(&doubles);
+	ary_release(&strs);
+	ary_release(&out);
+
+	done_testing();
+}
@@ -0,0 +1,35 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary(double) a;
+struct ary(int) b;
+
+int main()
+{
+	const char *path = "ary_map.tmp";
+	int i, sum;
+
+	ok(ary_map(&a, path, ARY_MAP_CREATE | ARY_MAP_TRUNC), "Mapped Array");
+	is(a.len, (size_t)0, "%zu", "Array is empty");
+	for (i = 0; i < 10000; i++)
+		ary_push(&a, i * 0.5);
+	ok(ary_sync(&a), "Synced Array");
+	ary_release(&a);
+
+	ok(ary_map(&a, path, 0), "Mapped Array again");
+	is(a.len, (size_t)10000, "%zu", "It has 10000 elements");
+	for (i = 0, sum = 0; i < 10000; i++)
+		sum += a.buf[i] == i * 0.5;
+	is(sum, 10000, "%d", "All elements are intact");
+	ary_setlen(&a, 10);
+	ary_release(&a);
+
+	ok(ary_map(&a, path, 0), "Mapped Array once more");
+	is(a.len, (size_t)10, "%zu", "Release stored the length");
+	ary_release(&a);
+
+	ok(!ary_map(&b, path, 0), "Array of another type can't be mapped");
+	remove(path);
+
+	done_testing();
+}
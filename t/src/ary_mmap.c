@@ -0,0 +1,43 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary(int) a;
+struct ary_mmap mm;
+
+int main()
+{
+	size_t i, n = 1 << 20, sum;
+
+	ary_mmap_init(&mm, 64 * 1024, 0);
+	ok(ary_init_with_alloc(&a, 0, &mm.allocator), "Initialized Array");
+	for (i = 0; i < n; i++)
+		ary_push(&a, (int)i + 1);
+	for (i = 0, sum = 0; i < n; i++)
+		sum += a.buf[i] == (int)i + 1;
+	is(sum, n, "%zu", "Array grown into a remapped buffer is intact");
+
+	ary_setlen(&a, n - 4096);
+	is(a.buf[n - 1], (int)n, "%d", "Shrinking a little keeps the pages");
+	ary_setlen(&a, n / 4);
+	is(a.buf[n / 2], 0, "%d", "Halving the length gives them back");
+	for (i = n / 4; i < n; i++)
+		ary_push(&a, (int)i + 1);
+	for (i = 0, sum = 0; i < n; i++)
+		sum += a.buf[i] == (int)i + 1;
+	is(sum, n, "%zu", "Trimmed pages are used again");
+
+	ary_setlen(&a, 1000);
+	ok(ary_shrinktofit(&a), "Shrunk Array below the threshold");
+	for (i = 0, sum = 0; i < 1000; i++)
+		sum += a.buf[i] == (int)i + 1;
+	is(sum, (size_t)1000, "%zu", "and kept the elements");
+
+	ary_release(&a);
+	ok(!a.buf && !a.len, "Released Array");
+	ary_init_with_alloc(&a, n, &mm.allocator);
+	ary_push(&a, 1);
+	ary_release(&a);
+	ok(!a.buf, "Released a mapped Array");
+
+	done_testing();
+}
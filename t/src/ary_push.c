@@ -2,9 +2,18 @@
 #include "ary.h"
 
 struct ary(int) a;
+struct ary(int) b;
+
+static void ctor(void *buf, void *userp)
+{
+	(*(int *)userp)++;
+	*(int *)buf = 5;
+}
 
 int main()
 {
+	int batch[] = {1, 2, 3, 4}, calls = 0, *p;
+
 	ary_init(&a, 0);
 
 	ok(ary_push(&a, 10), "Pushed 10 to Array");
@@ -18,7 +27,36 @@ int main()
 	is(a.buf[1], 20, "%d", "2. element is 20");
 	is(a.buf[2], 30, "%d", "3. element is 30");
 
+	ok(ary_extend(&a, batch, 4), "Extended Array by 4 elements");
+	is(a.len, (size_t)7, "%zu", "It now has 7 elements");
+	is(a.buf[6], 4, "%d", "7. element is 4");
+	ok(ary_extend_from(&a, &a), "Extended Array by itself");
+	is(a.len, (size_t)14, "%zu", "It now has 14 elements");
+	is(a.buf[7], 10, "%d", "8. element is 10");
+	is(a.buf[13], 4, "%d", "14. element is 4");
+
+	p = ary_push_n_uninit(&a, 3);
+	ok(p == &a.buf[14], "Added 3 uninitialized slots");
+	is(a.len, (size_t)17, "%zu", "It now has 17 elements");
+	p[0] = p[1] = p[2] = 0;
+
+	ary_setinitval(&a, 9);
+	ok(ary_push_n(&a, 100), "Created 100 elements");
+	is(a.buf[116], 9, "%d", "they are set to the init-value");
+
+	ary_init(&b, 0);
+	ary_setcbs(&b, ctor, NULL);
+	ary_setuserp(&b, &calls);
+	ok(ary_push_n(&b, 10), "Created 10 elements with a constructor");
+	is(calls, 10, "%d", "which was called for each");
+	is(b.buf[9], 5, "%d", "10. element is 5");
+	ok(ary_extend_from(&b, &a), "Extended by another Array");
+	is(b.len, (size_t)127, "%zu", "It now has 127 elements");
+	ok(!memcmp(b.buf + 10, a.buf, a.len * sizeof(int)),
+	   "with its elements");
+
 	ary_release(&a);
+	ary_release(&b);
 
 	done_testing();
 }
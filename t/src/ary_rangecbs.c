@@ -0,0 +1,87 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_int a;
+struct ary_charptr s;
+
+static size_t ncalls, nelems, nfreed;
+
+static void countfree(void *ptr)
+{
+	nfreed++;
+	free(ptr);
+}
+
+static void rctor(void *first, size_t n, void *userp)
+{
+	int *elem = first;
+
+	(void)userp;
+	ncalls++;
+	while (n--)
+		*elem++ = 7;
+}
+
+static void rdtor(void *first, size_t n, void *userp)
+{
+	(void)first;
+	(void)userp;
+	ncalls++;
+	nelems += n;
+}
+
+static void dtor(void *buf, void *userp)
+{
+	(void)buf;
+	(void)userp;
+	ncalls += 100;
+}
+
+int main()
+{
+	int i;
+
+	ary_init(&a, 0);
+	ary_setcbs(&a, NULL, dtor);
+	ary_setrangecbs(&a, rctor, rdtor);
+
+	ok(ary_push_n(&a, 10), "Created 10 elements");
+	is(ncalls, (size_t)1, "%zu", "with a single call");
+	is(a.buf[9], 7, "%d", "10. element is 7");
+
+	ncalls = 0;
+	ary_setlen(&a, 4);
+	is(ncalls, (size_t)1, "%zu", "Truncated to 4 elements with a single call");
+	is(nelems, (size_t)6, "%zu", "destructing 6 elements");
+
+	ary_pop(&a, NULL);
+	ary_shift(&a, NULL);
+	is(ncalls, (size_t)3, "%zu", "Popped and shifted with a range of one");
+
+	ncalls = nelems = 0;
+	for (i = 0; i < 8; i++)
+		ary_push(&a, i);
+	ary_splice(&a, 2, 5, NULL, 0);
+	is(ncalls, (size_t)1, "%zu", "Spliced out 5 elements with a single call");
+	is(nelems, (size_t)5, "%zu", "destructing 5 elements");
+
+	ncalls = nelems = 0;
+	ary_release(&a);
+	is(ncalls, (size_t)1, "%zu", "Released Array with a single call");
+	is(nelems, (size_t)5, "%zu", "destructing the remaining 5 elements");
+
+	ary_init(&s, 0);
+	ary_setrangecbs(&s, NULL, ary_cb_freecharptrs);
+	for (i = 0; i < 100; i++)
+		ary_push(&s, strdup("x"));
+	ary_use_as_free(countfree);
+	ary_setlen(&s, 50);
+	is(nfreed, (size_t)50, "%zu", "Freed 50 strings in a batch");
+	nfreed = 0;
+	ary_release(&s);
+	is(nfreed, (size_t)51, "%zu",
+	   "and the other 50 and the buffer on release");
+	ary_use_as_free(free);
+
+	done_testing();
+}
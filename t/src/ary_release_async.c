@@ -0,0 +1,57 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_int a;
+struct ary_charptr s;
+
+static size_t ndtor;
+
+static void dtor(void *buf, void *userp)
+{
+	(void)buf;
+	(void)userp;
+	ndtor++;
+}
+
+int main()
+{
+	int i;
+
+	ary_init(&a, 0);
+	ary_setcbs(&a, NULL, dtor);
+	for (i = 0; i < 100; i++)
+		ary_push(&a, i);
+	ary_release_async(&a);
+	ok(!a.buf && !a.len, "Released Array asynchronously");
+	is(ndtor, (size_t)0, "%zu", "no destructor was called yet");
+
+	ok(ary_reclaim_step(30), "Reclaimed part of it");
+	is(ndtor, (size_t)30, "%zu", "30 destructors were called");
+	ok(!ary_reclaim_step(0), "Reclaimed the rest");
+	is(ndtor, (size_t)100, "%zu", "all destructors were called");
+	ok(!ary_reclaim_step(0), "Nothing is left");
+
+	ary_init(&a, 0);
+	ary_push(&a, 1);
+	ary_release_async(&a);
+	ary_init(&s, 0);
+	ary_setcbs(&s, NULL, ary_cb_freecharptr);
+	for (i = 0; i < 100; i++)
+		ary_push(&s, strdup("x"));
+	ary_release_async(&s);
+	ok(ary_reclaim_step(10), "Arrays are reclaimed in order");
+	ok(!ary_reclaim_step(0), "until none is left");
+
+	ok(ary_reclaim_start(), "Started the reclaim thread");
+	ok(ary_reclaim_start(), "starting it again is fine");
+	ary_init(&a, 0);
+	ary_setcbs(&a, NULL, dtor);
+	for (i = 0; i < 10; i++)
+		ary_push(&a, i);
+	ary_release_async(&a);
+	ary_reclaim_stop();
+	is(ndtor, (size_t)110, "%zu", "Everything is reclaimed after stopping");
+	ok(!ary_reclaim_step(0), "Nothing is left");
+
+	done_testing();
+}
@@ -0,0 +1,70 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_char c;
+struct ary_int a;
+struct rgb {
+	char c[3];
+};
+
+struct ary(struct rgb) odd;
+
+int main()
+{
+	uint64_t seed = 1;
+	size_t i, n = 1000;
+	int sum = 0, moved = 0, ordered = 1, reversed = 1;
+
+	ary_init(&c, 0);
+	for (i = 0; i < 100; i++)
+		ary_push(&c, (char)i);
+	ok(ary_reverse(&c), "Reversed a char-Array");
+	for (i = 0; i < c.len; i++)
+		reversed &= c.buf[i] == (char)(99 - i);
+	ok(reversed, "its elements are in reverse order");
+	ary_release(&c);
+
+	ary_init(&odd, 0);
+	for (i = 0; i < 5; i++) {
+		ary_pushp(&odd);
+		memset(odd.buf[i].c, (int)i, 3);
+	}
+	ary_reverse(&odd);
+	ok(odd.buf[0].c[2] == 4 && odd.buf[4].c[0] == 0,
+	   "Reversed an Array of 3-byte elements");
+	ok(ary_swap(&odd, 0, 4), "Swapped its first and last element");
+	ok(odd.buf[0].c[1] == 0 && odd.buf[4].c[1] == 4, "they are swapped");
+	ary_release(&odd);
+
+	ary_init(&a, 0);
+	for (i = 0; i < n; i++)
+		ary_push(&a, (int)i);
+	ary_rotate(&a, 3);
+	ok(a.buf[0] == 3 && a.buf[n - 1] == 2, "Rotated by 3");
+	ary_rotate(&a, n - 3);
+	ok(a.buf[0] == 0 && a.buf[n - 1] == (int)n - 1, "and back");
+	ary_rotate(&a, 400);
+	ok(a.buf[0] == 400 && a.buf[599] == (int)n - 1 && a.buf[600] == 0,
+	   "Rotated by 400");
+	ary_rotate(&a, n + 600);
+	for (i = 0; i < n; i++)
+		ordered &= a.buf[i] == (int)i;
+	ok(ordered, "and back modulo the length");
+
+	ary_shuffle(&a, ary_cb_splitmix64, &seed);
+	for (i = 0; i < n; i++) {
+		sum += a.buf[i];
+		moved += a.buf[i] != (int)i;
+	}
+	is(sum, (int)(n * (n - 1) / 2), "%d", "Shuffled the Array");
+	ok(moved > 900, "almost all elements were moved");
+	ary_sort_int(&a);
+	for (i = 0; i < n; i++)
+		ordered &= a.buf[i] == (int)i;
+	ok(ordered, "it's still a permutation");
+	ary_shuffle(&a, NULL, NULL);
+	ok(a.buf[0] != 0 || a.buf[1] != 1, "Shuffled it with the defaults");
+	ary_release(&a);
+
+	done_testing();
+}
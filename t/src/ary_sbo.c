@@ -0,0 +1,37 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_sbo(int, 4) a;
+
+int main()
+{
+	int *buf, i;
+	size_t len;
+
+	ok(ary_sbo_init(&a, 0), "Initialized Array");
+	is(ary_avail(&a), (size_t)4, "%zu", "It has a capacity of 4");
+	ok(a.buf == a.inl, "and uses the inline storage");
+
+	for (i = 0; i < 4; i++)
+		ary_push(&a, i);
+	ok(a.buf == a.inl, "4 elements fit in the inline storage");
+	ary_push(&a, 4);
+	ok(a.buf != a.inl, "5 elements spilled to the heap");
+	is(a.buf[4], 4, "%d", "5. element is 4");
+	is(a.buf[0], 0, "%d", "1. element is 0");
+
+	ary_splice(&a, 0, 3, NULL, 0);
+	ok(ary_shrinktofit(&a), "Shrinked Array");
+	ok(a.buf == a.inl, "It uses the inline storage again");
+	is(a.buf[1], 4, "%d", "2. element is 4");
+
+	buf = ary_detach(&a, &len);
+	is(len, (size_t)2, "%zu", "Detached 2 elements");
+	ok(buf && buf != a.inl, "into a new buffer");
+	ok(a.buf == a.inl && !a.len, "Array is empty and uses the inline storage");
+	free(buf);
+
+	ary_sbo_release(&a);
+
+	done_testing();
+}
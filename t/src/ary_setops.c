@@ -0,0 +1,73 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_int a;
+struct ary_int b;
+struct ary_int r;
+
+static int cmp(const void *x, const void *y)
+{
+	return ary_cb_cmpint(x, y);
+}
+
+static int equals(const int *vals, size_t n)
+{
+	return r.len == n && !memcmp(r.buf, vals, n * sizeof(int));
+}
+
+int main()
+{
+	int avals[] = {1, 2, 4, 6, 8, 9, 10, 12}, bvals[] = {2, 3, 4, 9, 13};
+	int uni[] = {1, 2, 3, 4, 6, 8, 9, 10, 12, 13}, isect[] = {2, 4, 9};
+	int diff[] = {1, 6, 8, 10, 12}, symdiff[] = {1, 3, 6, 8, 10, 12, 13};
+	int i;
+
+	ary_init(&a, 0);
+	ary_init(&b, 0);
+	ary_extend(&a, avals, 8);
+	ary_extend(&b, bvals, 5);
+
+	ok(ary_set_union(&a, &b, &r, cmp) && equals(uni, 10), "Union");
+	ary_release(&r);
+	ok(ary_set_intersect(&a, &b, &r, cmp) && equals(isect, 3),
+	   "Intersection");
+	ary_release(&r);
+	ok(ary_set_intersect(&a, &b, &r, ary_cb_cmpint) && equals(isect, 3),
+	   "Intersection of ints");
+	ary_release(&r);
+	ok(ary_set_difference(&a, &b, &r, cmp) && equals(diff, 5),
+	   "Difference");
+	ary_release(&r);
+	ok(ary_set_symdiff(&a, &b, &r, ary_cb_cmpint) && equals(symdiff, 7),
+	   "Symmetric difference");
+	ary_release(&r);
+
+	ary_clear(&a);
+	for (i = 0; i < 10000; i++)
+		ary_push(&a, i * 2);
+	ok(ary_set_intersect(&a, &b, &r, ary_cb_cmpint) && equals(isect, 2),
+	   "Intersection with a much larger array");
+	ary_release(&r);
+	ok(ary_set_difference(&b, &a, &r, cmp) && r.len == 3 &&
+	   r.buf[0] == 3 && r.buf[2] == 13, "Difference to a much larger array");
+	ary_release(&r);
+
+	ary_clear(&b);
+	ary_push(&b, 4);
+	ary_push(&b, 4);
+	ary_push(&b, 4);
+	ary_clear(&a);
+	ary_push(&a, 4);
+	ary_push(&a, 4);
+	ok(ary_set_intersect(&a, &b, &r, ary_cb_cmpint) && r.len == 2,
+	   "Duplicates are matched once");
+	ary_release(&r);
+	ok(ary_set_union(&a, &b, &r, ary_cb_cmpint) && r.len == 3,
+	   "and kept as often as they occur in either array");
+	ary_release(&r);
+
+	ary_release(&a);
+	ary_release(&b);
+
+	done_testing();
+}
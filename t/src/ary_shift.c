@@ -0,0 +1,50 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary(int) a;
+
+int main()
+{
+	int i, ret, sum;
+
+	ary_init(&a, 0);
+	ary_push(&a, 10);
+	ary_push(&a, 20);
+	ary_push(&a, 30);
+
+	ok(ary_shift(&a, &ret), "Shifted from Array");
+	is(ret, 10, "%d", "Shifted element is 10");
+	is(a.len, (size_t)2, "%zu", "It now has 2 elements");
+	is(a.buf[0], 20, "%d", "1. element is 20");
+
+	ok(ary_unshift(&a, 5), "Unshifted 5 to Array");
+	is(a.buf[0], 5, "%d", "1. element is 5");
+	is(a.buf[2], 30, "%d", "3. element is 30");
+	ary_release(&a);
+
+	ary_init(&a, 0);
+	ary_setdeque(&a, 1);
+	for (i = 0; i < 1000; i++)
+		ary_push(&a, i);
+	for (i = 0, sum = 0; i < 500; i++) {
+		ary_shift(&a, &ret);
+		sum += ret == i;
+	}
+	is(sum, 500, "%d", "Deque shifted 500 elements in order");
+	is(a.buf[0], 500, "%d", "1. element is 500");
+	ok(a.s.head > 0, "Unused memory is kept in front of the buffer");
+	for (i = 0; i < 600; i++)
+		ary_unshift(&a, -i);
+	is(a.len, (size_t)1100, "%zu", "It now has 1100 elements");
+	is(a.buf[0], -599, "%d", "1. element is -599");
+	is(a.buf[600], 500, "%d", "601. element is 500");
+	ary_splice(&a, 1, 2, ((int[]){1, 2, 3}), 3);
+	is(a.buf[3], 3, "%d", "Spliced near the beginning");
+	is(a.buf[4], -596, "%d", "and kept the other elements");
+	ok(ary_shrinktofit(&a), "Shrinked the array");
+	is(a.s.head, (size_t)0, "%zu", "No unused memory is left in front");
+	is(a.buf[1100], 999, "%d", "Last element is 999");
+	ary_release(&a);
+
+	done_testing();
+}
@@ -0,0 +1,55 @@
+#include "tap.h"
+#include "ary.h"
+
+ARY_SOA_DEFINE(static, recs, (int, id), (double, score), (char, tag))
+
+struct recs r;
+struct ary_size_t order;
+
+int main()
+{
+	size_t i, pos;
+	int key = 3, sorted = 1;
+
+	recs_init(&r);
+	ok(recs_push(&r, 3, 0.5, 'c'), "Pushed a row");
+	ok(recs_push(&r, 1, 0.25, 'a'), "Pushed another row");
+	for (i = 0; i < 100; i++)
+		recs_push(&r, 100 + (int)i, 1.0 / (double)(i + 1), 'x');
+	is(r.len, (size_t)102, "%zu", "It now has 102 rows");
+	ok(r.id.len == 102 && r.score.len == 102 && r.tag.len == 102,
+	   "and so have all columns");
+	ok(r.id.s.alloc == r.score.s.alloc && r.id.s.alloc == r.tag.s.alloc,
+	   "which grew together");
+	ok(ary_index(&r.id, &pos, 0, &key, NULL) && pos == 0,
+	   "A column is a regular Array");
+
+	ok(ary_argsort(&r.score, &order, ary_cb_cmpdouble),
+	   "Argsorted a column");
+	is(order.buf[0], (size_t)101, "%zu",
+	   "the smallest score is in row 101");
+	ary_release(&order);
+
+	ok(recs_sort(&r, &r.score.s, ary_cb_cmpdouble), "Sorted by score");
+	for (i = 1; i < r.len; i++)
+		sorted &= r.score.buf[i - 1] <= r.score.buf[i];
+	ok(sorted, "the scores are in order");
+	ok(r.id.buf[0] == 199 && r.tag.buf[0] == 'x',
+	   "along with the other columns");
+	ok(r.id.buf[r.len - 1] == 100 && r.score.buf[r.len - 1] == 1.0,
+	   "the last row too");
+
+	ok(recs_splicep(&r, 1, 100, 1), "Replaced 100 rows with one");
+	r.id.buf[1] = 7;
+	r.score.buf[1] = 7.5;
+	r.tag.buf[1] = 'z';
+	is(r.len, (size_t)3, "%zu", "It now has 3 rows");
+	ok(r.tag.len == 3 && r.id.buf[2] == 100, "the last row moved up");
+	ok(recs_pop(&r), "Popped a row");
+	ok(r.len == 2 && r.score.len == 2 && r.tag.buf[1] == 'z',
+	   "from all columns");
+	recs_release(&r);
+	is(r.len, (size_t)0, "%zu", "Released it");
+
+	done_testing();
+}
@@ -0,0 +1,48 @@
+#include "tap.h"
+#include "ary.h"
+
+/* ARY_PARALLEL_CUTOFF in ary.c, each thread gets at least half of it */
+#define CUTOFF 65536
+
+struct ary_int orig, a, b;
+
+int main()
+{
+	size_t lens[] = { 0, 1, CUTOFF - 1, CUTOFF, CUTOFF + 1, 2 * CUTOFF - 1,
+	                  2 * CUTOFF + 1, 3 * CUTOFF + 7 };
+	size_t nlens = sizeof(lens) / sizeof(lens[0]), i, nthreads, sorted;
+	uint64_t seed = 1;
+
+	ary_init(&orig, 0);
+	for (i = 0; i < 3 * CUTOFF + 7; i++) {
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+		/* plenty of duplicates */
+		ary_push(&orig, (int)(seed >> 33) % 1000 - 500);
+	}
+	for (nthreads = 1; nthreads <= 4; nthreads++) {
+		for (i = 0, sorted = 0; i < nlens; i++) {
+			ary_clone(&orig, &a);
+			ary_setlen(&a, lens[i]);
+			ary_clone(&a, &b);
+			if (b.len)
+				ary_sort(&b, ary_cb_cmpint);
+			ary_sort_parallel(&a, ary_cb_cmpint, nthreads);
+			sorted += a.len == lens[i] &&
+			          (!a.len || !memcmp(a.buf, b.buf,
+			                             a.len * sizeof(int)));
+			ary_release(&a);
+			ary_release(&b);
+		}
+		is(sorted, nlens, "%zu", "Sorted all lengths around the cutoff");
+	}
+
+	ary_clone(&orig, &a);
+	ary_sort_parallel(&a, ary_cb_cmpint, 0);
+	for (i = 1; i < a.len && a.buf[i - 1] <= a.buf[i]; i++)
+		;
+	is(i, a.len, "%zu", "Sorted with a thread per processor");
+	ary_release(&a);
+	ary_release(&orig);
+
+	done_testing();
+}
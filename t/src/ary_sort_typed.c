@@ -0,0 +1,158 @@
+#include "tap.h"
+#include "ary.h"
+
+struct pos {
+	int x, y;
+};
+
+#define POS_LT(a, b) ((a).x < (b).x || ((a).x == (b).x && (a).y < (b).y))
+ARY_SORT_DEFINE(static, sort_pos, struct pos, POS_LT)
+
+#define sort_pos(ary) sort_pos((ary)->buf, (ary)->len)
+
+struct ary_int i32;
+struct ary_long l;
+struct ary_vlong ll;
+struct ary_size_t sz;
+struct ary_double d;
+struct ary_char c;
+struct ary(struct pos) p;
+
+static const size_t lens[] = { 0, 1, 100, 1023, 1024, 5000 };
+#define NLENS (sizeof(lens) / sizeof(lens[0]))
+
+static uint64_t rnd(void)
+{
+	static uint64_t x = 88172645463325252ULL;
+
+	x ^= x << 13;
+	x ^= x >> 7;
+	x ^= x << 17;
+	return x;
+}
+
+static void *failrealloc(void *ptr, size_t nmemb, size_t size)
+{
+	(void)ptr;
+	(void)nmemb;
+	(void)size;
+	return NULL;
+}
+
+static int cmppos(const void *a, const void *b)
+{
+	const struct pos *x = a, *y = b;
+
+	return POS_LT(*x, *y) ? -1 : POS_LT(*y, *x) ? 1 : 0;
+}
+
+/* fill an array with `n` elements of random bits, every fourth one repeats an
+ * earlier one */
+#define FILL(ary, n)                                                           \
+	do {                                                                   \
+		size_t i_;                                                     \
+		uint64_t r_[2];                                                \
+		void *p_;                                                      \
+		ary_clear(ary);                                                \
+		for (i_ = 0; i_ < (n); i_++) {                                 \
+			r_[0] = rnd();                                         \
+			r_[1] = rnd();                                         \
+			if ((p_ = ary_pushp(ary)))                             \
+				memcpy(p_, r_, sizeof(*(ary)->buf));           \
+			if (i_ % 4 == 3)                                       \
+				(ary)->buf[i_] = (ary)->buf[i_ / 2];           \
+		}                                                              \
+	} while (0)
+
+/* sort an array and count it in `same` if it equals the result of qsort() */
+#define SORT(ary, sort, cmp, same)                                             \
+	do {                                                                   \
+		size_t n_ = (ary)->len, sz_ = sizeof(*(ary)->buf), i_;         \
+		char *copy_ = malloc(n_ * sz_ + 1);                            \
+		if (n_)                                                        \
+			memcpy(copy_, (ary)->buf, n_ * sz_);                   \
+		qsort(copy_, n_, sz_, (cmp));                                  \
+		sort(ary);                                                     \
+		for (i_ = 0; i_ < n_; i_++)                                    \
+			if ((cmp)(&(ary)->buf[i_], copy_ + i_ * sz_))          \
+				break;                                         \
+		(same) += i_ == n_;                                            \
+		free(copy_);                                                   \
+	} while (0)
+
+int main()
+{
+	ary_xalloc_t xrealloc = ary_xrealloc;
+	size_t i, j, same;
+
+	ary_init(&i32, 0);
+	ary_init(&l, 0);
+	ary_init(&ll, 0);
+	ary_init(&sz, 0);
+	ary_init(&d, 0);
+	ary_init(&c, 0);
+	ary_init(&p, 0);
+	for (i = 0, same = 0; i < NLENS; i++) {
+		FILL(&i32, lens[i]);
+		SORT(&i32, ary_sort_int, ary_cb_cmpint, same);
+	}
+	is(same, NLENS, "%zu", "Sorted ints, radix sorted from 1024 on");
+	for (i = 0, same = 0; i < NLENS; i++) {
+		FILL(&l, lens[i]);
+		SORT(&l, ary_sort_long, ary_cb_cmplong, same);
+	}
+	is(same, NLENS, "%zu", "Sorted longs");
+	for (i = 0, same = 0; i < NLENS; i++) {
+		FILL(&ll, lens[i]);
+		SORT(&ll, ary_sort_vlong, ary_cb_cmpvlong, same);
+	}
+	is(same, NLENS, "%zu", "Sorted long longs");
+	for (i = 0, same = 0; i < NLENS; i++) {
+		FILL(&sz, lens[i]);
+		SORT(&sz, ary_sort_size_t, ary_cb_cmpsize_t, same);
+	}
+	is(same, NLENS, "%zu", "Sorted size_ts");
+	for (i = 0, same = 0; i < NLENS; i++) {
+		FILL(&c, lens[i]);
+		SORT(&c, ary_sort_char, ary_cb_cmpchar, same);
+	}
+	is(same, NLENS, "%zu", "Sorted chars");
+	for (i = 0, same = 0; i < NLENS; i++) {
+		FILL(&p, lens[i]);
+		SORT(&p, sort_pos, cmppos, same);
+	}
+	is(same, NLENS, "%zu", "Sorted with ARY_SORT_DEFINE()");
+
+	for (i = 0, same = 0; i < NLENS; i++) {
+		ary_clear(&d);
+		for (j = 0; j < lens[i]; j++)
+			ary_push(&d, (double)(int)rnd() / ((j % 3) ? 7 : -3));
+		if (d.len > 3) {
+			d.buf[1] = -0.0;
+			d.buf[2] = 0.0;
+			d.buf[3] = -1e300;
+		}
+		SORT(&d, ary_sort_double, ary_cb_cmpdouble, same);
+	}
+	is(same, NLENS, "%zu", "Sorted doubles of either sign");
+
+	FILL(&i32, 5000);
+	FILL(&ll, 5000);
+	ary_use_as_realloc(failrealloc);
+	same = 0;
+	SORT(&i32, ary_sort_int, ary_cb_cmpint, same);
+	SORT(&ll, ary_sort_vlong, ary_cb_cmpvlong, same);
+	ary_use_as_realloc(xrealloc);
+	is(same, (size_t)2, "%zu",
+	   "Without memory for radix sorting, introsort is used");
+
+	ary_release(&i32);
+	ary_release(&l);
+	ary_release(&ll);
+	ary_release(&sz);
+	ary_release(&d);
+	ary_release(&c);
+	ary_release(&p);
+
+	done_testing();
+}
@@ -0,0 +1,65 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_size_t a;
+struct ary_size_t b;
+struct ary_size_t m;
+
+static int cmp(const void *x, const void *y)
+{
+	return ary_cb_cmpsize_t(x, y);
+}
+
+int main()
+{
+	size_t vals[] = {1, 3, 3, 3, 5, 8}, more[] = {0, 3, 4, 9};
+	size_t key, lo, hi, pos, i;
+
+	ary_init(&a, 0);
+	ary_init(&b, 0);
+	ary_extend(&a, vals, 6);
+	ary_extend(&b, more, 4);
+
+	key = 3;
+	is(ary_lower_bound(&a, &key, ary_cb_cmpsize_t), (size_t)1, "%zu",
+	   "Lower bound of 3 is 1");
+	is(ary_upper_bound(&a, &key, ary_cb_cmpsize_t), (size_t)4, "%zu",
+	   "Upper bound of 3 is 4");
+	is(ary_lower_bound(&a, &key, cmp), (size_t)1, "%zu",
+	   "also with a custom comparison function");
+	is(ary_equal_range(&a, &lo, &hi, &key, cmp), (size_t)3, "%zu",
+	   "3 occurs 3 times");
+	ok(lo == 1 && hi == 4, "at positions 1 to 3");
+	ok(ary_search(&a, &pos, 0, &key, cmp), "Found 3");
+	is(pos, (size_t)1, "%zu", "the first one at position 1");
+	key = 9;
+	is(ary_lower_bound(&a, &key, cmp), (size_t)6, "%zu",
+	   "9 would be appended");
+	ok(!ary_search(&a, &pos, 0, &key, cmp), "but isn't found");
+
+	key = 4;
+	ok(ary_insert_sorted(&a, &key, ary_cb_cmpsize_t), "Inserted 4");
+	is(a.buf[4], (size_t)4, "%zu", "at position 4");
+	is(a.len, (size_t)7, "%zu", "Array now has 7 elements");
+	ary_shrinktofit(&a);
+	ok(ary_insert_sorted(&a, &a.buf[2], cmp), "Inserted an own element");
+	ok(a.len == 8 && a.buf[2] == 3 && a.buf[4] == 3 && a.buf[5] == 4,
+	   "after its equals");
+	ary_shrinktofit(&a);
+	ok(ary_insert_sorted(&a, &a.buf[7], cmp), "Inserted the last one");
+	ok(a.len == 9 && a.buf[7] == 8 && a.buf[8] == 8, "at the end");
+	ary_pop(&a, NULL);
+	ary_remove(&a, 2);
+
+	ok(ary_merge_sorted(&a, &b, &m, cmp), "Merged two arrays");
+	is(m.len, (size_t)11, "%zu", "It has 11 elements");
+	for (i = 1; i < m.len && m.buf[i - 1] <= m.buf[i]; i++)
+		;
+	is(i, m.len, "%zu", "which are sorted");
+
+	ary_release(&a);
+	ary_release(&b);
+	ary_release(&m);
+
+	done_testing();
+}
@@ -0,0 +1,101 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_int a;
+struct ary_int b;
+struct ary_sbo(int, 8) c;
+
+static size_t nexported, exported[6];
+
+static void ctor(void *buf, void *userp)
+{
+	(void)userp;
+	*(int *)buf = 1;
+}
+
+static void dtor(void *buf, void *userp)
+{
+	(void)buf;
+	(void)userp;
+}
+
+static void export(const char *name, size_t val, void *userp)
+{
+	(void)name;
+	(void)userp;
+	if (nexported < 6)
+		exported[nexported] = val;
+	nexported++;
+}
+
+int main()
+{
+	struct ary_stats st, total;
+	int i;
+
+	ary_stats_reset();
+	ary_init(&a, 0);
+	ary_stats(&a, &st);
+	ok(!st.grows && !st.moved && !st.peak && !st.wasted,
+	   "A new Array has no counts");
+
+	for (i = 0; i < 100; i++)
+		ary_push(&a, i);
+	ary_stats(&a, &st);
+	ok(st.grows > 0 && st.grows < 100, "Pushing grows geometrically");
+	is(st.peak, a.s.alloc * sizeof(int), "%zu", "Peak is the capacity");
+	is(st.wasted, (a.s.alloc - a.len) * sizeof(int), "%zu",
+	   "Wasted is the unused capacity");
+	is(st.moved, (size_t)0, "%zu", "Nothing was moved");
+
+	ary_shift(&a, NULL);
+	ary_stats(&a, &st);
+	is(st.moved, 99 * sizeof(int), "%zu", "Shifting moved the rest");
+	ary_insert(&a, 9, -1);
+	ary_stats(&a, &st);
+	is(st.moved, 99 * sizeof(int) + 90 * sizeof(int), "%zu",
+	   "Inserting moved the elements behind");
+	ary_shrinktofit(&a);
+	ary_stats(&a, &st);
+	is(st.wasted, (size_t)0, "%zu", "Nothing is wasted after shrinking");
+	ok(st.peak > a.s.alloc * sizeof(int), "but the peak remains");
+
+	ary_sbo_init(&c, 0);
+	ary_setdeque(&c, 1);
+	ary_push(&c, 1);
+	ary_push(&c, 2);
+	ary_shift(&c, NULL);
+	ary_stats(&c, &st);
+	is(st.wasted, (size_t)0, "%zu", "Inline storage is never wasted");
+	ary_release(&c);
+
+	ary_init(&b, 0);
+	ary_setcbs(&b, ctor, dtor);
+	ary_push_n(&b, 10);
+	ary_pop(&b, NULL);
+	ary_setlen(&b, 5);
+	ary_stats(&b, &st);
+	is(st.ctors, (size_t)10, "%zu", "Constructors were counted");
+	is(st.dtors, (size_t)5, "%zu", "Destructors were counted");
+
+	ary_stats_total(&total);
+	ok(total.grows >= st.grows + 1, "Totals sum up all Arrays");
+	is(total.ctors, (size_t)10, "%zu", "with their constructors");
+	ok(total.peak >= 100 * sizeof(int), "Total peak is the highest one");
+	ary_release(&b);
+	ary_stats_total(&total);
+	is(total.dtors, (size_t)10, "%zu", "Releasing destructs the rest");
+	ary_release(&a);
+	ary_stats(&a, &st);
+	ok(!st.grows && !st.peak, "Releasing resets the Array's counts");
+
+	ary_stats_export(&total, export, NULL);
+	is(nexported, (size_t)6, "%zu", "Exported all counters");
+	ok(exported[0] == total.grows && exported[5] == total.dtors,
+	   "with their values");
+	ary_stats_reset();
+	ary_stats_total(&total);
+	ok(!total.grows && !total.peak && !total.dtors, "Reset the totals");
+
+	done_testing();
+}
@@ -0,0 +1,71 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary_int a;
+struct ary_int b;
+struct ary_int c;
+struct ary_sbo(int, 8) d;
+
+int main()
+{
+	struct ary_tracesite sites[4];
+	int i, linea, lineb;
+
+	ary_init(&a, 0); linea = __LINE__;
+	ary_init(&b, 0); lineb = __LINE__;
+	for (i = 0; i < 1000; i++)
+		ary_push(&a, i);
+	ary_grow(&b, 10);
+
+	is(ary_trace_report(sites, 4), (size_t)2, "%zu", "Two call sites");
+	ok(!strcmp(sites[0].file, __FILE__), "with the file");
+	is(sites[0].line, linea, "%d", "and line of the largest first");
+	is(sites[0].live, a.s.alloc * sizeof(int), "%zu",
+	   "Live bytes are the capacity");
+	ok(sites[0].grows > 1 && sites[0].grows < 1000, "Grows were counted");
+	is(sites[1].line, lineb, "%d", "Then the smaller one");
+	is(sites[1].grows, (size_t)1, "%zu", "which grew once");
+
+	ary_shrinktofit(&a);
+	ary_trace_report(sites, 4);
+	is(sites[0].live, (size_t)1000 * sizeof(int), "%zu",
+	   "Shrinking reduces the live bytes");
+	ary_release(&a);
+	ary_push(&a, 1);
+	ary_trace_report(sites, 4);
+	ok(sites[0].line == lineb && sites[1].line == linea,
+	   "Releasing drops them");
+	is(sites[1].live, sizeof(int), "%zu",
+	   "a released Array keeps its call site");
+	ary_release(&a);
+	ary_release(&b);
+	ary_trace_report(sites, 4);
+	ok(!sites[0].live && !sites[1].live, "Nothing is live anymore");
+
+	ary_sbo_init(&d, 0);
+	ary_setdeque(&d, 1);
+	for (i = 0; i < 4; i++)
+		ary_push(&d, i);
+	ary_shift(&d, NULL);
+	ary_shift(&d, NULL);
+	for (i = 0; i < 4; i++)
+		ary_push(&d, i);
+	ary_shrinktofit(&d);
+	is(ary_trace_report(sites, 4), (size_t)2, "%zu",
+	   "Shifted inline storage isn't charged to its call site");
+	ary_sbo_release(&d);
+
+	ary_trace_sample(4096);
+	ary_init(&c, 0);
+	for (i = 0; i < 100000; i++)
+		ary_push(&c, i);
+	is(ary_trace_report(sites, 1), (size_t)3, "%zu", "Sampled a new site");
+	ok(sites[0].live >= c.s.alloc * sizeof(int) - 4096 &&
+	   sites[0].live <= c.s.alloc * sizeof(int) + 4096,
+	   "Sampled live bytes are close to the capacity");
+	ary_release(&c);
+	ary_trace_report(sites, 1);
+	is(sites[0].live, (size_t)0, "%zu", "and go away on release");
+
+	done_testing();
+}
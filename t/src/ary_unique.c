@@ -0,0 +1,30 @@
+#include "tap.h"
+#include "ary.h"
+
+struct ary(int) a;
+
+int main()
+{
+	ary_init(&a, 0);
+	ary_splice(&a, 0, 0, ((int[]){3, 1, 3, 2, 1, 3, 4, 2}), 8);
+
+	ok(ary_unique(&a, ary_cb_cmpint), "Removed duplicates");
+	is(a.len, (size_t)4, "%zu", "4 elements are left");
+	is(a.buf[0], 3, "%d", "1. element is 3");
+	is(a.buf[1], 1, "%d", "2. element is 1");
+	is(a.buf[2], 2, "%d", "3. element is 2");
+	is(a.buf[3], 4, "%d", "4. element is 4");
+
+	ary_clear(&a);
+	ary_splice(&a, 0, 0, ((int[]){1, 1, 2, 3, 3, 3, 5}), 7);
+	ary_unique_sorted(&a, ary_cb_cmpint);
+	is(a.len, (size_t)4, "%zu", "Sorted array has 4 elements left");
+	is(a.buf[0], 1, "%d", "1. element is 1");
+	is(a.buf[1], 2, "%d", "2. element is 2");
+	is(a.buf[2], 3, "%d", "3. element is 3");
+	is(a.buf[3], 5, "%d", "4. element is 5");
+
+	ary_release(&a);
+
+	done_testing();
+}